@@ -5,8 +5,26 @@
 #include <omp.h>
 #include <fstream>
 #include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <sstream>
+#include <cstdio>
+#include <memory>
 #include "main_opencl.cpp"
 #include "main_openmp.cpp"
+#include "main_simd.cpp"
+#include "main_subdivision.cpp"
+#include "main_scheduler.cpp"
+#include "main_palette.cpp"
+#include "main_progressive.cpp"
+#include "main_maxiter.cpp"
+#include "main_antialias.cpp"
+#include "main_tilecache.cpp"
+#include "main_multidevice.cpp"
+#include "main_hybrid.cpp"
+#include "main_doubledouble.cpp"
+#include "main_perturbation.cpp"
+#include "main_benchsuite.cpp"
 #include "lodepng.h" // 添加lodepng库头文件
 
 double x_start = -2.0f, x_finish = 2.0f;
@@ -35,6 +53,54 @@ void benchmarkOpenCL(int width, int height, int iterations, double& init_duratio
     std::cout << "OpenCL computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
 }
 
+// 启动时间: 冷启动前清空程序二进制缓存, 热启动直接加载上一次写入的二进制.
+// 计时包含构造和第一帧, 因为单精度和特化上限的变体在第一次使用时才构建
+template<typename T>
+void benchmarkOpenCLStartup(int width, int height, double& cold_duration, double& warm_duration, KernelCacheStats& warm_stats) {
+    KernelCache("kernel_cache").clear();
+    std::vector<uint8_t> output(width * height * 3);
+    double durations[2];
+
+    for (int run = 0; run < 2; ++run) {
+        auto start = std::chrono::high_resolution_clock::now();
+        MandelbrotOpenCL mandelbrotOpenCL(width, height, "kernel_cache");
+        mandelbrotOpenCL.compute(output.data(), static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+        auto end = std::chrono::high_resolution_clock::now();
+        durations[run] = std::chrono::duration<double>(end - start).count();
+        warm_stats = mandelbrotOpenCL.cacheStats();
+    }
+    cold_duration = durations[0];
+    warm_duration = durations[1];
+
+    std::cout << "OpenCL cold startup time: " << cold_duration << " seconds" << std::endl;
+    std::cout << "OpenCL warm startup time: " << warm_duration << " seconds (" << warm_stats.hits << " cached programs, " << warm_stats.misses << " compiled)" << std::endl;
+}
+
+// 双缓冲异步版本: 提交第 i 帧后再消费第 i - 1 帧 (拷贝到可分页内存模拟调用方的处理)
+template<typename T>
+void benchmarkOpenCLAsync(int width, int height, int iterations, double& compute_duration) {
+    MandelbrotOpenCL mandelbrotOpenCL(width, height);
+    mandelbrotOpenCL.initAsync(2);
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    MandelbrotOpenCL::AsyncFrame previous;
+    for (int i = 0; i < iterations; ++i) {
+        MandelbrotOpenCL::AsyncFrame frame = mandelbrotOpenCL.computeAsync(static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+        if (i > 0) {
+            std::memcpy(output.data(), mandelbrotOpenCL.waitFrame(previous), output.size());
+            mandelbrotOpenCL.releaseFrame(previous);
+        }
+        previous = frame;
+    }
+    std::memcpy(output.data(), mandelbrotOpenCL.waitFrame(previous), output.size());
+    mandelbrotOpenCL.releaseFrame(previous);
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    std::cout << "OpenCL async computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
+}
+
 template<typename T>
 void benchmarkOpenMP(int width, int height, int iterations, double& init_duration, double& compute_duration) {
     auto start_init = std::chrono::high_resolution_clock::now();
@@ -56,6 +122,403 @@ void benchmarkOpenMP(int width, int height, int iterations, double& init_duratio
     std::cout << "OpenMP computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
 }
 
+template<typename T>
+void benchmarkSIMD(int width, int height, int iterations, double& init_duration, double& compute_duration) {
+    auto start_init = std::chrono::high_resolution_clock::now();
+
+    std::vector<uint8_t> output(width * height * 3);
+    SimdLevel level = simd_level();
+
+    auto end_init = std::chrono::high_resolution_clock::now();
+    init_duration = std::chrono::duration<double>(end_init - start_init).count();
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_simd(output.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    std::cout << "SIMD (" << simd_level_name(level) << ") initialization time: " << init_duration << " seconds" << std::endl;
+    std::cout << "SIMD (" << simd_level_name(level) << ") computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
+}
+
+template<typename T>
+void benchmarkSubdivision(int width, int height, int iterations, double view_x_start, double view_x_finish, double view_y_start, double view_y_finish,
+                          double& compute_duration, SubdivisionStats& stats) {
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_subdivision(output.data(), width, height, static_cast<T>(view_x_start), static_cast<T>(view_x_finish), static_cast<T>(view_y_start), static_cast<T>(view_y_finish), static_cast<T>(center_x), static_cast<T>(center_y), 64, &stats);
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    std::cout << "Subdivision computation time for " << iterations << " iterations: " << compute_duration << " seconds"
+              << " (" << 100.0 * stats.filled / (static_cast<double>(width) * height) << "% pixels filled)" << std::endl;
+}
+
+// 开启内部快捷路径的 OpenMP 版本, 统计值为每帧平均
+template<typename T>
+void benchmarkShortcuts(int width, int height, int iterations, double& compute_duration, ShortcutStats& shortcuts) {
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_omp(output.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y), &shortcuts);
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    shortcuts.cardioid /= iterations;
+    shortcuts.bulb /= iterations;
+    shortcuts.periodic /= iterations;
+
+    std::cout << "OpenMP + shortcuts computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
+    std::cout << "Shortcut pixels per frame: cardioid " << shortcuts.cardioid << ", bulb " << shortcuts.bulb << ", periodic " << shortcuts.periodic << std::endl;
+}
+
+// 工作窃取 tile 调度, 与 mandelbrot_omp 默认的静态调度对比
+template<typename T>
+void benchmarkOpenMPTiled(int width, int height, int iterations, int tile_size, double& compute_duration) {
+    std::vector<uint8_t> output(width * height * 3);
+    TileScheduler scheduler(tile_size);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_omp_tiled(output.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y),
+                             nullptr, 256, &scheduler);
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    std::cout << "OpenMP work-stealing (tile " << tile_size << ") computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
+}
+
+// 迭代场 + 查表着色, 分别计时; 重新着色 (换调色板) 只需要第二部分
+template<typename T>
+void benchmarkPalette(int width, int height, int iterations, double& field_duration, double& colorize_duration) {
+    std::vector<uint16_t> field(width * height);
+    std::vector<uint8_t> output(width * height * 3);
+    Palette palette;
+    field_duration = 0.0;
+    colorize_duration = 0.0;
+
+    for (int i = 0; i < iterations; ++i) {
+        auto start_field = std::chrono::high_resolution_clock::now();
+        mandelbrot_field(field.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+        auto start_colorize = std::chrono::high_resolution_clock::now();
+        colorize(field.data(), width * height, palette, output.data());
+        auto end_colorize = std::chrono::high_resolution_clock::now();
+        field_duration += std::chrono::duration<double>(start_colorize - start_field).count();
+        colorize_duration += std::chrono::duration<double>(end_colorize - start_colorize).count();
+    }
+
+    std::cout << "Iteration field computation time for " << iterations << " iterations: " << field_duration << " seconds" << std::endl;
+    std::cout << "Palette colorize time for " << iterations << " iterations: " << colorize_duration << " seconds" << std::endl;
+}
+
+// 渐进渲染: 分别统计第一遍 (首帧可见) 和细化到全分辨率的时间
+template<typename T>
+void benchmarkProgressive(int width, int height, int iterations, double& first_image_duration, double& full_duration) {
+    std::vector<uint8_t> output(width * height * 3);
+    ProgressiveRenderer<T> renderer(width, height, 16);
+    first_image_duration = 0.0;
+    full_duration = 0.0;
+
+    for (int i = 0; i < iterations; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        renderer.begin(static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish));
+        bool done = renderer.refine(output.data());
+        auto first_image = std::chrono::high_resolution_clock::now();
+        while (!done) {
+            done = renderer.refine(output.data());
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        first_image_duration += std::chrono::duration<double>(first_image - start).count();
+        full_duration += std::chrono::duration<double>(end - start).count();
+    }
+
+    std::cout << "Progressive time to first image for " << iterations << " iterations: " << first_image_duration << " seconds" << std::endl;
+    std::cout << "Progressive time to full resolution for " << iterations << " iterations: " << full_duration << " seconds" << std::endl;
+}
+
+// 固定迭代上限的吞吐量 (百万像素/秒); 上限为 2 的幂时走编译期实例化的循环
+template<typename T>
+void benchmarkMaxIter(int width, int height, int iterations, int max_iter, double& throughput) {
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_omp(output.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y), nullptr, max_iter);
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    double compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+    throughput = static_cast<double>(width) * height * iterations / compute_duration / 1e6;
+
+    std::cout << "OpenMP max_iter " << max_iter << (is_specialised_max_iter(max_iter) ? " (compile-time)" : " (runtime)") << " throughput: " << throughput << " Mpixel/s" << std::endl;
+}
+
+// 自适应抗锯齿: 每帧 8 个子采样, 只作用于边界像素
+template<typename T>
+void benchmarkAntialias(int width, int height, int iterations, double& compute_duration, AntialiasStats& stats) {
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_antialias(output.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y), 8, 2, &stats);
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    std::cout << "Adaptive anti-aliasing computation time for " << iterations << " iterations: " << compute_duration << " seconds" << std::endl;
+    std::cout << "Supersampled pixels: " << 100.0 * stats.fraction << "%" << std::endl;
+}
+
+// 输出视图: 同一帧按不同的像素格式, 行序和行距写出; row_padding 为每行末尾额外的字节数 (模拟带填充的图像).
+// OpenCL 的初始化不计入时间
+template<typename T>
+void benchmarkOutputView(int width, int height, int iterations, PixelFormat format, Orientation orientation, int row_padding, bool use_opencl,
+                         double& compute_duration) {
+    size_t row_bytes = static_cast<size_t>(width) * pixel_size(format) + row_padding;
+    std::vector<uint8_t> output(row_bytes * height);
+    OutputView view(output.data(), width, height, format, orientation, row_bytes);
+    std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+    if (use_opencl) {
+        mandelbrotOpenCL.reset(new MandelbrotOpenCL(width, height));
+    }
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        if (use_opencl) {
+            mandelbrotOpenCL->compute(view, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+        } else {
+            mandelbrot_omp(view, width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+        }
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+}
+
+// 批量渲染 count 张 size x size 的小图像 (视口沿边界分布), 与逐张调用比较; 结果为每秒图像数.
+// OpenCL 的初始化和第一次使用时的变体构建不计入时间
+template<typename T>
+void benchmarkBatch(int size, int count, int iterations, bool use_opencl, double& single_rate, double& batch_rate) {
+    size_t image_bytes = static_cast<size_t>(size) * size * 3;
+    std::vector<uint8_t> output(image_bytes * count);
+    std::vector<BatchViewport<T>> views;
+    for (int i = 0; i < count; ++i) {
+        double cx = -0.75 + 0.5 * std::sin(0.7 * i);
+        double cy = 0.3 * std::cos(1.3 * i);
+        double half = 0.05 + 0.02 * (i % 7);
+        views.push_back({static_cast<T>(cx - half), static_cast<T>(cx + half), static_cast<T>(cy - half), static_cast<T>(cy + half), output.data() + i * image_bytes});
+    }
+    std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+    if (use_opencl) {
+        mandelbrotOpenCL.reset(new MandelbrotOpenCL(size, size));
+        mandelbrotOpenCL->computeBatch(views);
+    }
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        for (const BatchViewport<T>& view : views) {
+            if (use_opencl) {
+                mandelbrotOpenCL->compute(view.output, view.x_start, view.x_finish, view.y_start, view.y_finish, static_cast<T>(center_x), static_cast<T>(center_y));
+            } else {
+                mandelbrot_omp(view.output, size, size, view.x_start, view.x_finish, view.y_start, view.y_finish, static_cast<T>(center_x), static_cast<T>(center_y));
+            }
+        }
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    single_rate = static_cast<double>(iterations) * count / std::chrono::duration<double>(end_compute - start_compute).count();
+
+    start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        if (use_opencl) {
+            mandelbrotOpenCL->computeBatch(views);
+        } else {
+            mandelbrot_omp_batch(views, size, size);
+        }
+    }
+    end_compute = std::chrono::high_resolution_clock::now();
+    batch_rate = static_cast<double>(iterations) * count / std::chrono::duration<double>(end_compute - start_compute).count();
+}
+
+// tile 缓存: 第一帧全部未命中, 之后同一视口的请求全部命中内存
+void benchmarkTileCache(int width, int height, int iterations, double& first_duration, double& cached_duration, TileCacheStats& stats) {
+    std::vector<uint8_t> output(width * height * 3);
+    TileCache cache;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    cache.render(output.data(), width, height, x_start, x_finish, y_start, y_finish);
+    auto first = std::chrono::high_resolution_clock::now();
+    for (int i = 1; i < iterations; ++i) {
+        cache.render(output.data(), width, height, x_start, x_finish, y_start, y_finish);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    first_duration = std::chrono::duration<double>(first - start).count();
+    cached_duration = std::chrono::duration<double>(end - first).count() / std::max(1, iterations - 1);
+    stats = cache.stats();
+
+    std::cout << "Tile cache first frame: " << first_duration << " seconds, cached frame: " << cached_duration << " seconds" << std::endl;
+    std::cout << "Tile cache: " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+}
+
+// 所有 OpenCL 设备分带渲染; 第一帧按设备数均分, 之后按上一帧的耗时重新分配条带
+template<typename T>
+void benchmarkMultiDevice(int width, int height, int iterations, double& compute_duration, std::string& bands) {
+    DeviceSelection selection;
+    selection.type = CL_DEVICE_TYPE_ALL;
+    MultiDeviceOpenCL multiDevice(width, height, selection);
+    std::vector<uint8_t> output(width * height * 3);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        multiDevice.compute(output.data(), static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end - start).count();
+
+    bands.clear();
+    for (int i = 0; i < multiDevice.deviceCount(); ++i) {
+        bands += (i ? ", " : "") + multiDevice.deviceName(i) + " " + std::to_string(multiDevice.bands()[i]) + " rows";
+    }
+    std::cout << "Multi-device OpenCL computation time for " << iterations << " iterations: " << compute_duration << " seconds (" << bands << ")" << std::endl;
+}
+
+// OpenMP 与 OpenCL 协同渲染; 前几帧用于收敛分界行, 计时从第 warmup 帧之后开始
+template<typename T>
+void benchmarkHybrid(int width, int height, int iterations, double& compute_duration, HybridStats& stats) {
+    MandelbrotOpenCL mandelbrotOpenCL(width, height);
+    HybridRenderer hybrid(width, height, mandelbrotOpenCL);
+    std::vector<uint8_t> output(width * height * 3);
+
+    const int warmup = 5;
+    for (int i = 0; i < warmup; ++i) {
+        hybrid.compute(output.data(), static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        hybrid.compute(output.data(), static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    compute_duration = std::chrono::duration<double>(end - start).count();
+    stats = hybrid.stats();
+
+    std::cout << "Hybrid computation time for " << iterations << " iterations: " << compute_duration << " seconds (OpenCL rows " << stats.split << "/" << height << ")" << std::endl;
+}
+
+// 任意精度对照: 每个像素直接用 BigFixed 定点数迭代, 与 MPFR 一类库的做法相同
+inline int bigfixed_escape(const BigFixed& c_re, const BigFixed& c_im, int max_iter) {
+    BigFixed real = c_re, imag = c_im;
+    BigFixed two(2.0, c_re.size());
+    BigFixed four(4.0, c_re.size());
+    int iter = 0;
+    for (int i = 0; i < max_iter; ++i) {
+        BigFixed real2 = real * real;
+        BigFixed imag2 = imag * imag;
+        // 先在定点数中减去 4 再转换, 直接转换 |z|^2 会把 4 + 1e-56 舍入成 4
+        if ((real2 + imag2 - four).toDouble() > 0.0) {
+            break;
+        }
+        imag = two * real * imag + c_im;
+        real = real2 - imag2 + c_re;
+        iter++;
+    }
+    return iter;
+}
+
+// 以实轴端点 -2 为中心的 1e-28 小视口: 端点附近逃逸次数随距离对数变化, double 已经无法区分相邻像素,
+// double-double 与 BigFixed 的迭代次数只在实轴 (轨道混沌, 舍入误差会被放大) 和 |c| = 2 的像素上可能不同.
+// 两者都是单线程, 只比较算术本身的代价
+void benchmarkDoubleDouble(int width, int height, double deep_scale, int max_iter, double& dd_duration, double& bigfixed_duration, int& mismatched,
+                           int& double_distinct, int& dd_distinct) {
+    double deep_center_x = -2.0, deep_center_y = 0.0;
+    double dx = deep_scale / width, dy = deep_scale / height;
+    double half = 0.5 * deep_scale;
+    std::vector<int> dd_iters(width * height), bigfixed_iters(width * height), double_iters(width * height);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            dd_iters[y * width + x] = mandelbrot_escape(dd_real(deep_center_x) + (x * dx - half), dd_real(deep_center_y) + (y * dy - half), max_iter);
+        }
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    int limbs = perturbation_limbs(deep_scale, width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            BigFixed c_re = BigFixed(deep_center_x, limbs) + BigFixed(x * dx - half, limbs);
+            BigFixed c_im = BigFixed(deep_center_y, limbs) + BigFixed(y * dy - half, limbs);
+            bigfixed_iters[y * width + x] = bigfixed_escape(c_re, c_im, max_iter);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    dd_duration = std::chrono::duration<double>(middle - start).count();
+    bigfixed_duration = std::chrono::duration<double>(end - middle).count();
+
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double_iters[y * width + x] = mandelbrot_escape(deep_center_x + (x * dx - half), deep_center_y + (y * dy - half), max_iter);
+        }
+    }
+    mismatched = 0;
+    for (int i = 0; i < width * height; ++i) {
+        mismatched += (dd_iters[i] != bigfixed_iters[i]);
+    }
+    std::sort(dd_iters.begin(), dd_iters.end());
+    std::sort(double_iters.begin(), double_iters.end());
+    dd_distinct = static_cast<int>(std::unique(dd_iters.begin(), dd_iters.end()) - dd_iters.begin());
+    double_distinct = static_cast<int>(std::unique(double_iters.begin(), double_iters.end()) - double_iters.begin());
+
+    std::cout << "Double-double time at scale " << deep_scale << ": " << dd_duration << " seconds, BigFixed (" << limbs << " limbs): " << bigfixed_duration << " seconds" << std::endl;
+    std::cout << "Double-double mismatched pixels against BigFixed: " << mismatched << std::endl;
+}
+
+// double-double 能区分相邻像素的深度: 按 mandelbrot_omp 的方式计算一行 pixels 个坐标,
+// 要求严格递增且每步与 dx 相差不超过一半. 中心取 lo 非零且 |c| 接近 2 的值, 舍入误差最大
+bool check_dd_resolution(int pixels, double deep_scale) {
+    dd_real center = dd_real(-5.9997) / 3;
+    dd_real start = center - dd_real(0.5 * deep_scale);
+    dd_real finish = center + dd_real(0.5 * deep_scale);
+    dd_real dx = (finish - start) / pixels;
+    dd_real previous = start;
+    for (int x = 1; x < pixels; ++x) {
+        dd_real current = start + x * dx;
+        double step = static_cast<double>(current - previous) / static_cast<double>(dx);
+        if (!(previous < current) || std::fabs(step - 1) > 0.5) {
+            return false;
+        }
+        previous = current;
+    }
+    return true;
+}
+
+// 整帧 double-double 渲染 (OpenMP 与 OpenCL), 视口与 benchmarkDoubleDouble 相同
+void benchmarkDoubleDoubleEngines(int width, int height, int iterations, double deep_scale, int max_iter, double& omp_duration, double& opencl_duration) {
+    dd_real half = 0.5 * deep_scale;
+    dd_real deep_center_x(-2.0), deep_center_y(0.0);
+    std::vector<uint8_t> output(width * height * 3);
+    MandelbrotOpenCL mandelbrotOpenCL(width, height);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_omp(output.data(), width, height, deep_center_x - half, deep_center_x + half, deep_center_y - half, deep_center_y + half, deep_center_x, deep_center_y,
+                       nullptr, max_iter);
+    }
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrotOpenCL.compute(output.data(), deep_center_x - half, deep_center_x + half, deep_center_y - half, deep_center_y + half, deep_center_x, deep_center_y,
+                                 nullptr, max_iter);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    omp_duration = std::chrono::duration<double>(middle - start).count();
+    opencl_duration = std::chrono::duration<double>(end - middle).count();
+
+    std::cout << "Double-double OpenMP time for " << iterations << " iterations: " << omp_duration << " seconds, OpenCL: " << opencl_duration << " seconds" << std::endl;
+}
+
 template<typename T>
 void benchmarkSingleThread(int width, int height, int iterations, double& init_duration, double& compute_duration) {
     auto start_init = std::chrono::high_resolution_clock::now();
@@ -85,11 +548,47 @@ bool check_consistency(int width, int height, double x_start, double x_finish, d
     MandelbrotOpenCL mandelbrotOpenCL(width, height);
     mandelbrotOpenCL.compute(output_opencl.data(), x_start, x_finish, y_start, y_finish, center_x, center_y);
 
-    // 保存结果为PNG图片
+    // 先保存结果为PNG图片, 后面任何一项比较失败都能对照图片检查
     lodepng::encode("output/output_omp.png", output_omp, width, height, LCT_RGB);
     lodepng::encode("output/output_single.png", output_single, width, height, LCT_RGB);
     lodepng::encode("output/output_opencl.png", output_opencl, width, height, LCT_RGB);
 
+    ShortcutStats shortcuts;
+    std::vector<uint8_t> output_shortcut(width * height * 3);
+    mandelbrot_omp(output_shortcut.data(), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, &shortcuts);
+    if (output_shortcut != output_omp) {
+        return false;
+    }
+
+    std::vector<uint8_t> output_tiled(width * height * 3);
+    mandelbrot_omp_tiled(output_tiled.data(), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+    lodepng::encode("output/output_tiled.png", output_tiled, width, height, LCT_RGB);
+    if (output_tiled != output_omp) {
+        return false;
+    }
+
+    // 细分只直接填充逃逸带, 集合内部逐点计算, 结果必须与逐点计算逐字节一致
+    std::vector<uint8_t> output_subdivision(width * height * 3);
+    mandelbrot_subdivision(output_subdivision.data(), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+    lodepng::encode("output/output_subdivision.png", output_subdivision, width, height, LCT_RGB);
+    if (output_subdivision != output_omp) {
+        return false;
+    }
+
+    // 默认调色板由 mandelbrot_color 生成, 迭代场 + 查表必须与直接着色一致
+    std::vector<uint16_t> field(width * height);
+    std::vector<uint8_t> output_palette(width * height * 3);
+    mandelbrot_field(field.data(), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+    colorize(field.data(), width * height, Palette(), output_palette.data());
+    if (output_palette != output_omp) {
+        return false;
+    }
+    std::vector<uint16_t> field_opencl(width * height);
+    mandelbrotOpenCL.computeField(field_opencl.data(), x_start, x_finish, y_start, y_finish);
+    if (field_opencl != field) {
+        return false;
+    }
+
     for (int i = 0; i < width * height * 3; ++i) {
         if (output_omp[i] != output_single[i] || output_omp[i] != output_opencl[i]) {
             return false;
@@ -98,39 +597,453 @@ bool check_consistency(int width, int height, double x_start, double x_finish, d
     return true;
 }
 
+// SIMD 引擎必须与同精度的标量结果逐字节一致
+template<typename T>
+bool check_simd_consistency(int width, int height, double x_start, double x_finish, double y_start, double y_finish, double center_x, double center_y) {
+    std::vector<uint8_t> output_simd(width * height * 3);
+    std::vector<uint8_t> output_single(width * height * 3);
+
+    mandelbrot_simd(output_simd.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    mandelbrot_single_thread(output_single.data(), width, height, static_cast<T>(x_start), static_cast<T>(x_finish), static_cast<T>(y_start), static_cast<T>(y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+
+    return output_simd == output_single;
+}
+
+// 以内部区域为主的视图上比较 Mariani–Silver 细分与逐点 OpenMP, 并统计与逐点结果不同的像素
+template<typename T>
+void compare_subdivision(int width, int height, int iterations) {
+    double view_x_start = -1.6, view_x_finish = 0.4;
+    double view_y_start = -1.0, view_y_finish = 1.0;
+
+    std::vector<uint8_t> output_omp(width * height * 3);
+    std::vector<uint8_t> output_subdivision(width * height * 3);
+
+    auto start_compute = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        mandelbrot_omp(output_omp.data(), width, height, static_cast<T>(view_x_start), static_cast<T>(view_x_finish), static_cast<T>(view_y_start), static_cast<T>(view_y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+    }
+    auto end_compute = std::chrono::high_resolution_clock::now();
+    double omp_duration = std::chrono::duration<double>(end_compute - start_compute).count();
+
+    double subdivision_duration;
+    SubdivisionStats stats;
+    benchmarkSubdivision<T>(width, height, iterations, view_x_start, view_x_finish, view_y_start, view_y_finish, subdivision_duration, stats);
+    mandelbrot_subdivision(output_subdivision.data(), width, height, static_cast<T>(view_x_start), static_cast<T>(view_x_finish), static_cast<T>(view_y_start), static_cast<T>(view_y_finish), static_cast<T>(center_x), static_cast<T>(center_y));
+
+    long long mismatched = 0;
+    for (int i = 0; i < width * height; ++i) {
+        if (output_omp[i * 3] != output_subdivision[i * 3] || output_omp[i * 3 + 1] != output_subdivision[i * 3 + 1] || output_omp[i * 3 + 2] != output_subdivision[i * 3 + 2]) {
+            mismatched++;
+        }
+    }
+
+    std::ofstream result_file("output/speedup_result.txt", std::ios::app);
+    result_file << "Interior-heavy view OpenMP computation duration: " << omp_duration << " seconds" << std::endl;
+    result_file << "Interior-heavy view Subdivision computation duration: " << subdivision_duration << " seconds" << std::endl;
+    result_file << "Subdivision Speedup over OpenMP: " << omp_duration / subdivision_duration << "x" << std::endl;
+    result_file << "Subdivision mismatched pixels: " << mismatched << std::endl;
+    result_file.close();
+
+    std::cout << "Interior-heavy view OpenMP computation time: " << omp_duration << " seconds" << std::endl;
+    std::cout << "Subdivision Speedup over OpenMP: " << omp_duration / subdivision_duration << "x" << std::endl;
+    std::cout << "Subdivision mismatched pixels: " << mismatched << std::endl;
+}
+
 template<typename T>
 void calculate_speedup(int width, int height, int iterations) {
     double single_init_duration, single_compute_duration;
     double omp_init_duration, omp_compute_duration;
     double opencl_init_duration, opencl_compute_duration;
+    double simd_init_duration, simd_compute_duration;
+    double subdivision_compute_duration;
+    SubdivisionStats subdivision_stats;
+    double shortcut_compute_duration;
+    ShortcutStats shortcuts;
+    double opencl_async_compute_duration;
+    double opencl_cold_startup, opencl_warm_startup;
+    KernelCacheStats kernel_cache_stats;
 
     benchmarkSingleThread<T>(width, height, iterations, single_init_duration, single_compute_duration);
     benchmarkOpenMP<T>(width, height, iterations, omp_init_duration, omp_compute_duration);
     benchmarkOpenCL<T>(width, height, iterations, opencl_init_duration, opencl_compute_duration);
+    benchmarkOpenCLAsync<T>(width, height, iterations, opencl_async_compute_duration);
+    benchmarkOpenCLStartup<T>(width, height, opencl_cold_startup, opencl_warm_startup, kernel_cache_stats);
+    benchmarkSIMD<T>(width, height, iterations, simd_init_duration, simd_compute_duration);
+    benchmarkSubdivision<T>(width, height, iterations, x_start, x_finish, y_start, y_finish, subdivision_compute_duration, subdivision_stats);
+    benchmarkShortcuts<T>(width, height, iterations, shortcut_compute_duration, shortcuts);
 
     double omp_speedup = (single_compute_duration ) / (omp_compute_duration + omp_init_duration);
-    double opencl_speedup = (single_compute_duration ) / (opencl_compute_duration + opencl_init_duration);
+    // OpenCL 初始化 (编译程序) 是一次性开销, 单独报告, 不计入加速比
+    double opencl_speedup = (single_compute_duration ) / opencl_compute_duration;
+    double simd_speedup = (single_compute_duration ) / (simd_compute_duration + simd_init_duration);
+    double subdivision_speedup = (single_compute_duration ) / subdivision_compute_duration;
+    double shortcut_speedup = (single_compute_duration ) / shortcut_compute_duration;
 
     std::ofstream result_file("output/speedup_result.txt",std::ios::app);
 
     result_file << "Single-threaded initialization duration: " << single_init_duration << " seconds" << std::endl;
     result_file << "OpenMP initialization duration: " << omp_init_duration << " seconds" << std::endl;
     result_file << "OpenCL initialization duration: " << opencl_init_duration << " seconds" << std::endl;
+    result_file << "OpenCL cold startup duration (build from source): " << opencl_cold_startup << " seconds" << std::endl;
+    result_file << "OpenCL warm startup duration (" << kernel_cache_stats.hits << " cached binaries, " << kernel_cache_stats.misses << " compiled): " << opencl_warm_startup << " seconds" << std::endl;
+    result_file << "SIMD (" << simd_level_name(simd_level()) << ") initialization duration: " << simd_init_duration << " seconds" << std::endl;
 
     result_file << "Single-threaded computation duration: " << single_compute_duration << " seconds" << std::endl;
     result_file << "OpenMP computation duration: " << omp_compute_duration << " seconds" << std::endl;
     result_file << "OpenCL computation duration: " << opencl_compute_duration << " seconds" << std::endl;
+    result_file << "OpenCL async computation duration: " << opencl_async_compute_duration << " seconds" << std::endl;
+    result_file << "SIMD computation duration: " << simd_compute_duration << " seconds" << std::endl;
+    result_file << "Subdivision computation duration: " << subdivision_compute_duration << " seconds" << std::endl;
+    result_file << "OpenMP + shortcuts computation duration: " << shortcut_compute_duration << " seconds" << std::endl;
+    result_file << "Shortcut pixels per frame: cardioid " << shortcuts.cardioid << ", bulb " << shortcuts.bulb << ", periodic " << shortcuts.periodic << std::endl;
     result_file << "OpenMP Speedup: " << omp_speedup << "x" << std::endl;
     result_file << "OpenCL Speedup: " << opencl_speedup << "x" << std::endl;
+    result_file << "OpenCL async Speedup over blocking compute: " << opencl_compute_duration / opencl_async_compute_duration << "x" << std::endl;
+    result_file << "SIMD Speedup: " << simd_speedup << "x" << std::endl;
+    result_file << "Subdivision Speedup: " << subdivision_speedup << "x" << std::endl;
+    result_file << "OpenMP + shortcuts Speedup: " << shortcut_speedup << "x" << std::endl;
     result_file.close();
 
     std::cout << "OpenMP Speedup: " << omp_speedup << "x" << std::endl;
     std::cout << "OpenCL Speedup: " << opencl_speedup << "x" << std::endl;
+    std::cout << "OpenCL async Speedup over blocking compute: " << opencl_compute_duration / opencl_async_compute_duration << "x" << std::endl;
+    std::cout << "SIMD Speedup: " << simd_speedup << "x" << std::endl;
+    std::cout << "Subdivision Speedup: " << subdivision_speedup << "x" << std::endl;
+    std::cout << "OpenMP + shortcuts Speedup: " << shortcut_speedup << "x" << std::endl;
+
+    result_file.open("output/speedup_result.txt", std::ios::app);
+    for (int tile_size : {16, 32, 64}) {
+        double tiled_compute_duration;
+        benchmarkOpenMPTiled<T>(width, height, iterations, tile_size, tiled_compute_duration);
+        result_file << "OpenMP work-stealing (tile " << tile_size << ") computation duration: " << tiled_compute_duration << " seconds" << std::endl;
+        result_file << "OpenMP work-stealing (tile " << tile_size << ") Speedup over static schedule: " << omp_compute_duration / tiled_compute_duration << "x" << std::endl;
+        std::cout << "OpenMP work-stealing (tile " << tile_size << ") Speedup over static schedule: " << omp_compute_duration / tiled_compute_duration << "x" << std::endl;
+    }
+
+    double field_duration, colorize_duration;
+    benchmarkPalette<T>(width, height, iterations, field_duration, colorize_duration);
+    result_file << "Iteration field computation duration: " << field_duration << " seconds" << std::endl;
+    result_file << "Palette colorize duration: " << colorize_duration << " seconds" << std::endl;
+    result_file << "Iteration field + palette Speedup over fused OpenMP: " << omp_compute_duration / (field_duration + colorize_duration) << "x" << std::endl;
+    std::cout << "Iteration field + palette Speedup over fused OpenMP: " << omp_compute_duration / (field_duration + colorize_duration) << "x" << std::endl;
+
+    // 非渐进模式下首帧可见的时间就是整帧的计算时间
+    double first_image_duration, progressive_full_duration;
+    benchmarkProgressive<T>(width, height, iterations, first_image_duration, progressive_full_duration);
+    result_file << "Progressive time to first image: " << first_image_duration / iterations << " seconds per frame (OpenMP full frame: " << omp_compute_duration / iterations << ")" << std::endl;
+    result_file << "Progressive time to full resolution: " << progressive_full_duration / iterations << " seconds per frame" << std::endl;
+    std::cout << "Progressive time-to-first-image Speedup over OpenMP full frame: " << omp_compute_duration / first_image_duration << "x" << std::endl;
+
+    // 对照: 全图 8 倍超采样的代价约为 8 倍 OpenMP 时间
+    double antialias_duration;
+    AntialiasStats antialias;
+    benchmarkAntialias<T>(width, height, iterations, antialias_duration, antialias);
+    result_file << "Adaptive anti-aliasing (8 samples) computation duration: " << antialias_duration << " seconds" << std::endl;
+    result_file << "Adaptive anti-aliasing supersampled pixels: " << 100.0 * antialias.fraction << "%" << std::endl;
+    result_file << "Adaptive anti-aliasing cost relative to OpenMP: " << antialias_duration / omp_compute_duration << "x (full 8x supersampling: ~8x)" << std::endl;
+    std::cout << "Adaptive anti-aliasing cost relative to OpenMP: " << antialias_duration / omp_compute_duration << "x" << std::endl;
+
+    if (std::is_same<T, double>::value) {
+        double dd_duration, bigfixed_duration;
+        int dd_mismatched, double_distinct, dd_distinct;
+        benchmarkDoubleDouble(48, 48, 1e-28, 1024, dd_duration, bigfixed_duration, dd_mismatched, double_distinct, dd_distinct);
+        result_file << "Double-double computation duration (48x48, scale 1e-28): " << dd_duration << " seconds" << std::endl;
+        result_file << "BigFixed computation duration (48x48, scale 1e-28): " << bigfixed_duration << " seconds" << std::endl;
+        result_file << "Double-double Speedup over BigFixed: " << bigfixed_duration / dd_duration << "x, mismatched pixels: " << dd_mismatched << std::endl;
+        result_file << "Distinct iteration counts at scale 1e-28: double " << double_distinct << ", double-double " << dd_distinct << std::endl;
+        std::cout << "Double-double Speedup over BigFixed: " << bigfixed_duration / dd_duration << "x" << std::endl;
+
+        double dd_omp_duration, dd_opencl_duration;
+        int dd_iterations = std::max(1, iterations / 10);
+        benchmarkDoubleDoubleEngines(width, height, dd_iterations, 1e-28, 1024, dd_omp_duration, dd_opencl_duration);
+        result_file << "Double-double OpenMP computation duration (" << dd_iterations << " iterations, scale 1e-28): " << dd_omp_duration << " seconds" << std::endl;
+        result_file << "Double-double OpenCL computation duration (" << dd_iterations << " iterations, scale 1e-28): " << dd_opencl_duration << " seconds" << std::endl;
+    }
+
+    if (std::is_same<T, double>::value) {
+        double tile_first_duration, tile_cached_duration;
+        TileCacheStats tile_stats;
+        benchmarkTileCache(width, height, iterations, tile_first_duration, tile_cached_duration, tile_stats);
+        result_file << "Tile cache first frame duration: " << tile_first_duration << " seconds" << std::endl;
+        result_file << "Tile cache cached frame duration: " << tile_cached_duration << " seconds" << std::endl;
+        result_file << "Tile cache hits: " << tile_stats.hits << ", misses: " << tile_stats.misses << std::endl;
+    }
+
+    double multi_device_duration;
+    std::string multi_device_bands;
+    benchmarkMultiDevice<T>(width, height, iterations, multi_device_duration, multi_device_bands);
+    result_file << "Multi-device OpenCL computation duration: " << multi_device_duration << " seconds" << std::endl;
+    result_file << "Multi-device OpenCL bands: " << multi_device_bands << std::endl;
+    result_file << "Multi-device OpenCL Speedup over single device: " << opencl_compute_duration / multi_device_duration << "x" << std::endl;
+    std::cout << "Multi-device OpenCL Speedup over single device: " << opencl_compute_duration / multi_device_duration << "x" << std::endl;
+
+    double hybrid_duration;
+    HybridStats hybrid_stats;
+    benchmarkHybrid<T>(width, height, iterations, hybrid_duration, hybrid_stats);
+    result_file << "Hybrid (OpenMP + OpenCL) computation duration: " << hybrid_duration << " seconds" << std::endl;
+    result_file << "Hybrid OpenCL rows: " << hybrid_stats.split << "/" << height << ", OpenCL share of work: " << 100.0 * hybrid_stats.opencl_share << "%" << std::endl;
+    result_file << "Hybrid throughput: " << iterations * static_cast<double>(width) * height / hybrid_duration / 1e6 << " Mpixel/s (OpenMP alone "
+                << iterations * static_cast<double>(width) * height / omp_compute_duration / 1e6 << ", OpenCL alone "
+                << iterations * static_cast<double>(width) * height / opencl_compute_duration / 1e6 << ")" << std::endl;
+    std::cout << "Hybrid Speedup over OpenMP: " << omp_compute_duration / hybrid_duration << "x, over OpenCL: " << opencl_compute_duration / hybrid_duration << "x" << std::endl;
+
+    // 对照为原来的紧密 RGB 缓冲区 (omp_compute_duration / opencl_compute_duration)
+    struct ViewCase { const char* name; PixelFormat format; Orientation orientation; int padding; };
+    const ViewCase view_cases[] = {
+        {"RGB8", PIXEL_RGB8, BOTTOM_UP, 0},
+        {"RGBA8", PIXEL_RGBA8, BOTTOM_UP, 0},
+        {"uint16 iterations", PIXEL_ITER16, BOTTOM_UP, 0},
+        {"float smooth", PIXEL_SMOOTH32F, BOTTOM_UP, 0},
+        {"RGB8 top-down, 64-byte padded rows", PIXEL_RGB8, TOP_DOWN, 64},
+    };
+    for (bool use_opencl : {false, true}) {
+        const char* engine = use_opencl ? "OpenCL" : "OpenMP";
+        double baseline = use_opencl ? opencl_compute_duration : omp_compute_duration;
+        for (const ViewCase& view_case : view_cases) {
+            double view_duration;
+            benchmarkOutputView<T>(width, height, iterations, view_case.format, view_case.orientation, view_case.padding, use_opencl, view_duration);
+            result_file << engine << " output view (" << view_case.name << ") computation duration: " << view_duration << " seconds" << std::endl;
+            result_file << engine << " output view (" << view_case.name << ") Speedup over packed RGB: " << baseline / view_duration << "x" << std::endl;
+            std::cout << engine << " output view (" << view_case.name << ") Speedup over packed RGB: " << baseline / view_duration << "x" << std::endl;
+        }
+    }
+
+    // 缩略图: 每种尺寸 1000 张, 迭代次数按大图的十分之一
+    for (bool use_opencl : {false, true}) {
+        const char* engine = use_opencl ? "OpenCL" : "OpenMP";
+        for (int size : {32, 64, 128}) {
+            double single_rate, batch_rate;
+            benchmarkBatch<T>(size, 1000, std::max(1, iterations / 10), use_opencl, single_rate, batch_rate);
+            result_file << engine << " " << size << "x" << size << " thumbnails per-image throughput: " << single_rate << " images/s" << std::endl;
+            result_file << engine << " " << size << "x" << size << " thumbnails batched throughput: " << batch_rate << " images/s" << std::endl;
+            std::cout << engine << " " << size << "x" << size << " batched Speedup over per-image calls: " << batch_rate / single_rate << "x" << std::endl;
+        }
+    }
+
+    // 与相差 1 的运行时上限比较, 两者工作量几乎相同, 差别来自编译期常量上界
+    for (int max_iter : {256, 1024, 4096}) {
+        double specialised_throughput, runtime_throughput;
+        benchmarkMaxIter<T>(width, height, iterations, max_iter, specialised_throughput);
+        benchmarkMaxIter<T>(width, height, iterations, max_iter - 1, runtime_throughput);
+        result_file << "OpenMP max_iter " << max_iter << " (compile-time) throughput: " << specialised_throughput << " Mpixel/s" << std::endl;
+        result_file << "OpenMP max_iter " << max_iter - 1 << " (runtime) throughput: " << runtime_throughput << " Mpixel/s" << std::endl;
+    }
+    result_file.close();
 
     std::cout << "Speedup calculation completed. Results saved to speedup_result.txt" << std::endl;
 }
 
+// 基准测试套件: benchmark --suite [选项], 结果写成 JSON 和 CSV, 可与保存的 CSV 基线比较
+struct SuiteOptions {
+    std::vector<std::string> scenarios;                     // 为空表示全部场景
+    std::vector<std::string> engines = {"omp", "simd"};  // 有 OpenCL 设备时默认再加上 opencl
+    std::vector<std::pair<int, int>> resolutions = {{512, 512}, {1024, 1024}};
+    std::vector<int> threads;                               // 为空表示只用最大线程数
+    std::vector<int> tile_sizes = {16, 32, 64};             // tiled 引擎逐个测量, 结果记为 tiled-<边长>
+    int warmup = 2;
+    int repeats = 10;
+    std::string json = "output/bench.json";
+    std::string csv = "output/bench.csv";
+    std::string baseline;
+    double tolerance = 0.05;
+};
+
+std::vector<std::string> split_list(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+void printSuiteUsage(const char* program) {
+    std::cerr << "Usage: " << program << " --suite [--scenarios wide,boundary,interior,deep,zoom] [--engines omp,omp-rgba,tiled,simd,opencl]"
+              << " [--resolutions 512x512,1024x1024] [--threads 1,4,8] [--tile-sizes 16,32,64] [--warmup n] [--repeats n] [--json path] [--csv path]"
+              << " [--compare baseline.csv] [--tolerance 0.05]" << std::endl;
+}
+
+SuiteOptions parseSuiteOptions(int argc, char* argv[]) {
+    SuiteOptions options;
+    bool engines_given = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printSuiteUsage(argv[0]);
+            exit(1);
+        }
+        std::string value = argv[++i];
+        if (arg == "--scenarios") {
+            options.scenarios = split_list(value);
+        } else if (arg == "--engines") {
+            options.engines = split_list(value);
+            engines_given = true;
+        } else if (arg == "--resolutions") {
+            options.resolutions.clear();
+            for (const std::string& item : split_list(value)) {
+                int w = 0, h = 0;
+                if (std::sscanf(item.c_str(), "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0) {
+                    std::cerr << "Invalid resolution: " << item << std::endl;
+                    exit(1);
+                }
+                options.resolutions.push_back({w, h});
+            }
+        } else if (arg == "--threads") {
+            for (const std::string& item : split_list(value)) {
+                options.threads.push_back(std::max(1, std::stoi(item)));
+            }
+        } else if (arg == "--tile-sizes") {
+            options.tile_sizes.clear();
+            for (const std::string& item : split_list(value)) {
+                options.tile_sizes.push_back(std::max(1, std::stoi(item)));
+            }
+        } else if (arg == "--warmup") {
+            options.warmup = std::max(0, std::stoi(value));
+        } else if (arg == "--repeats") {
+            options.repeats = std::max(1, std::stoi(value));
+        } else if (arg == "--json") {
+            options.json = value;
+        } else if (arg == "--csv") {
+            options.csv = value;
+        } else if (arg == "--compare") {
+            options.baseline = value;
+        } else if (arg == "--tolerance") {
+            options.tolerance = std::stod(value);
+        } else {
+            printSuiteUsage(argv[0]);
+            exit(1);
+        }
+    }
+    if (options.threads.empty()) {
+        options.threads.push_back(omp_get_max_threads());
+    }
+    // 没有 OpenCL 运行时或设备的机器上默认套件只跑 CPU 引擎, 显式指定 opencl 时照常报错
+    if (!engines_given && opencl_available()) {
+        options.engines.push_back("opencl");
+    }
+    return options;
+}
+
+int run_suite(const SuiteOptions& options) {
+    std::vector<BenchScenario> scenarios;
+    for (const BenchScenario& scenario : bench_scenarios()) {
+        if (options.scenarios.empty() || std::find(options.scenarios.begin(), options.scenarios.end(), scenario.name) != options.scenarios.end()) {
+            scenarios.push_back(scenario);
+        }
+    }
+
+    int max_threads = omp_get_max_threads();
+    std::vector<BenchResult> results;
+    for (const auto& resolution : options.resolutions) {
+        int width = resolution.first, height = resolution.second;
+        double ratio = static_cast<double>(width) / height;
+        std::vector<uint8_t> output(width * height * 3);
+        std::vector<uint8_t> rgba_output(width * height * 4);
+        OutputView rgba(rgba_output.data(), width, height, PIXEL_RGBA8);
+        std::vector<uint16_t> field(width * height);
+
+        // OpenCL 的初始化 (平台, 上下文, 程序) 在计时之外完成
+        std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+        if (std::find(options.engines.begin(), options.engines.end(), "opencl") != options.engines.end()) {
+            mandelbrotOpenCL.reset(new MandelbrotOpenCL(width, height));
+        }
+
+        for (const BenchScenario& scenario : scenarios) {
+            struct View { double x_start, x_finish, y_start, y_finish; };
+            std::vector<View> views;
+            double scale = scenario.scale;
+            for (int f = 0; f < scenario.frames; ++f) {
+                views.push_back({scenario.center_x - 0.5 * ratio * scale, scenario.center_x + 0.5 * ratio * scale,
+                                 scenario.center_y - 0.5 * scale, scenario.center_y + 0.5 * scale});
+                scale *= scenario.zoom;
+            }
+
+            // 每次测量的总迭代次数, 用迭代场统计 (集合内部的像素按 max_iter 次计)
+            omp_set_num_threads(max_threads);
+            double iterations = 0.0;
+            for (const View& v : views) {
+                mandelbrot_field(field.data(), width, height, v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, scenario.max_iter);
+                long long sum = 0;
+                #pragma omp parallel for reduction(+:sum)
+                for (int i = 0; i < width * height; ++i) {
+                    sum += field[i];
+                }
+                iterations += static_cast<double>(sum);
+            }
+
+            for (const std::string& engine : options.engines) {
+                bool cpu = (engine != "opencl");
+                bool tiled = (engine == "tiled");
+                for (int tile_size : tiled ? options.tile_sizes : std::vector<int>{0}) {
+                    // 每种 tile 大小用自己的调度器, 代价表只在同一配置的帧之间延续
+                    TileScheduler scheduler(tile_size);
+                    std::string name = tiled ? engine + "-" + std::to_string(tile_size) : engine;
+                    for (int threads : cpu ? options.threads : std::vector<int>{0}) {
+                        if (cpu) {
+                            omp_set_num_threads(threads);
+                        }
+                        auto render = [&]() {
+                            for (const View& v : views) {
+                                if (engine == "omp") {
+                                    mandelbrot_omp(output.data(), width, height, v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, nullptr, scenario.max_iter);
+                                } else if (engine == "omp-rgba") {
+                                    mandelbrot_omp(rgba, width, height, v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, scenario.max_iter);
+                                } else if (engine == "tiled") {
+                                    mandelbrot_omp_tiled(output.data(), width, height, v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, nullptr, scenario.max_iter,
+                                                         &scheduler);
+                                } else if (engine == "simd") {
+                                    mandelbrot_simd(output.data(), width, height, v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, scenario.max_iter);
+                                } else if (engine == "opencl") {
+                                    mandelbrotOpenCL->compute(output.data(), v.x_start, v.x_finish, v.y_start, v.y_finish, scenario.center_x, scenario.center_y, nullptr, scenario.max_iter);
+                                } else {
+                                    std::cerr << "Unknown engine: " << engine << std::endl;
+                                    exit(1);
+                                }
+                            }
+                        };
+
+                        BenchResult result;
+                        result.scenario = scenario.name;
+                        result.engine = name;
+                        result.width = width;
+                        result.height = height;
+                        result.threads = threads;
+                        result.repeats = options.repeats;
+                        result.seconds = bench_run(render, options.warmup, options.repeats);
+                        result.pixels_per_second = static_cast<double>(width) * height * scenario.frames / result.seconds.median;
+                        result.iterations_per_second = iterations / result.seconds.median;
+                        results.push_back(result);
+
+                        std::cout << result.key() << ": median " << result.seconds.median << " s, p95 " << result.seconds.p95 << " s, stddev " << result.seconds.stddev
+                                  << " s, " << result.pixels_per_second / 1e6 << " Mpixel/s, " << result.iterations_per_second / 1e9 << " Giter/s" << std::endl;
+                    }
+                }
+            }
+        }
+    }
+    omp_set_num_threads(max_threads);
+
+    std::filesystem::create_directory("output");
+    write_bench_json(options.json, results);
+    write_bench_csv(options.csv, results);
+    std::cout << "Results saved to " << options.json << " and " << options.csv << std::endl;
+
+    if (!options.baseline.empty()) {
+        int regressions = compare_bench_results(results, read_bench_csv(options.baseline), options.tolerance);
+        std::cout << regressions << " regression(s) against " << options.baseline << std::endl;
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--suite") {
+        return run_suite(parseSuiteOptions(argc, argv));
+    }
+
     int width = 1024;
     int height = 1024;
     int iterations = 100;
@@ -148,16 +1061,33 @@ int main(int argc, char* argv[]) {
         std::cout << "Results are NOT consistent between parallel, single-threaded, and OpenCL computations." << std::endl;
     }
 
+    bool simd_consistent = check_simd_consistency<double>(width, height, x_start, x_finish, y_start, y_finish, center_x, center_y)
+                        && check_simd_consistency<float>(width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+    if (simd_consistent) {
+        std::cout << "SIMD results are identical to the single-threaded results for float and double." << std::endl;
+    } else {
+        std::cout << "SIMD results are NOT identical to the single-threaded results." << std::endl;
+    }
+
+    // main_doubledouble.cpp 中声明的深度: 600 行, 1e-28 的视口
+    if (check_dd_resolution(600, 1e-28)) {
+        std::cout << "Double-double separates adjacent pixels of a 600-row view at scale 1e-28." << std::endl;
+    } else {
+        std::cout << "Double-double does NOT separate adjacent pixels of a 600-row view at scale 1e-28." << std::endl;
+    }
+
 
     std::ofstream result_file("output/speedup_result.txt",std::ios::app);
     result_file << "Precision: Double" << std::endl;
     result_file.close();
     calculate_speedup<double>(width, height, iterations);
+    compare_subdivision<double>(width, height, iterations);
 
     result_file.open("output/speedup_result.txt", std::ios::app);
     result_file << "Precision: Float" << std::endl;
     result_file.close();
     calculate_speedup<float>(width, height, iterations);
+    compare_subdivision<float>(width, height, iterations);
 
     return 0;
 }
@@ -1,51 +1,500 @@
+// 用 -DMAX_ITER=N 编译时迭代上限是编译期常量, 循环可以展开, 内核参数 max_iter 被忽略
+#ifdef MAX_ITER
+#define ITER_LIMIT MAX_ITER
+#else
+#define ITER_LIMIT max_iter
+#endif
+
+// -DIMAGE_WIDTH=W -DIMAGE_HEIGHT=H 把图像尺寸编译成常量, 像素步长和下标计算不再依赖内核参数
+#ifdef IMAGE_WIDTH
+#define WIDTH_VALUE IMAGE_WIDTH
+#define HEIGHT_VALUE IMAGE_HEIGHT
+#else
+#define WIDTH_VALUE width
+#define HEIGHT_VALUE height
+#endif
+
+// 坐标类型, 单精度变体用 -DREAL=float 编译 (mandelbrot_dd 和 mandelbrot_perturb 除外)
+#ifndef REAL
+#define REAL double
+#endif
+
+// fractal 内核的迭代公式, 每种公式单独编译一个程序变体, 循环里没有按公式的分支.
+// 取值与 CPU 端 FractalKind 相同: 0 Mandelbrot, 1 Julia, 2 Multibrot (幂次为 POWER), 3 Burning Ship
+#ifndef FORMULA
+#define FORMULA 0
+#endif
+#ifndef POWER
+#define POWER 2
+#endif
+
+// 迭代次数对应的颜色, 按小端拼成 R | G << 8 | B << 16, 各内核着色都经由这里
+uint color_rgb(int iter, int max_iter) {
+    if (iter == max_iter) {
+        return 0; // 黑色
+    }
+
+    double t = (double)iter / max_iter;
+    double t1 = 1 - t;
+    uint r = (uchar)(9 * t1 * t * t * t * 255);
+    uint g = (uchar)(15 * t1 * t1 * t * t * 255);
+    uint b = (uchar)(8.5 * t1 * t1 * t1 * t * 255);
+    return r | (g << 8) | (b << 16);
+}
+
+void write_color(__global uchar* output, int idx, int iter, int max_iter) {
+    uint color = color_rgb(iter, max_iter);
+    output[idx] = (uchar)color;
+    output[idx + 1] = (uchar)(color >> 8);
+    output[idx + 2] = (uchar)(color >> 16);
+}
+
+// 与 write_color 相同的颜色写成一个 32 位字, 内存中依次为 R G B A
+void write_color_rgba(__global uchar* output, int index, int iter, int max_iter) {
+    ((__global uint*)output)[index] = 0xff000000u | color_rgb(iter, max_iter);
+}
+
+// 逃逸时间迭代的一步 z -> f(z) + c, formula 取值同 FORMULA. 调用处都传常量, 内联后没有按公式的分支;
+// real2, imag2 为本步已经算好的平方, 与逃逸判断共用
+void formula_step(REAL* real, REAL* imag, REAL real2, REAL imag2, REAL c_real, REAL c_imag, const int formula) {
+    if (formula == 2) {
+        // z^2 直接由 real2, imag2 得到, 其余各次逐次乘 z
+        REAL power_real = real2 - imag2;
+        REAL power_imag = 2 * *real * *imag;
+        #pragma unroll
+        for (int k = 2; k < POWER; ++k) {
+            REAL next = power_real * *real - power_imag * *imag;
+            power_imag = power_real * *imag + power_imag * *real;
+            power_real = next;
+        }
+        *real = power_real + c_real;
+        *imag = power_imag + c_imag;
+    } else if (formula == 3) {
+        *imag = 2 * fabs(*real * *imag) + c_imag;
+        *real = real2 - imag2 + c_real;
+    } else {
+        *imag = 2 * *real * *imag + c_imag;
+        *real = real2 - imag2 + c_real;
+    }
+}
+
+// 所有 REAL 内核共用的逃逸时间循环, 与 CPU 端 formula_escape 相同: 从 z = (real, imag) 开始迭代,
+// 返回逃逸前的迭代次数, 逃逸时 *norm 为 |z|^2. detect_period 非 0 时另外用 Brent 方法检测轨道循环
+// (与 CPU 端 mandelbrot_escape_shortcut 相同), 命中时 *periodic 为 1 并返回 max_iter
+int escape_loop(REAL real, REAL imag, REAL c_real, REAL c_imag, REAL bailout, int max_iter,
+                const int formula, const int detect_period, int* periodic, REAL* norm) {
+    REAL saved_real = real;
+    REAL saved_imag = imag;
+    int period = 0;
+    int power = 1;
+    int iter = 0;
+    REAL real2, imag2;
+    *periodic = 0;
+
+    for (int i = 0; i < max_iter; ++i) {
+        real2 = real * real;
+        imag2 = imag * imag;
+        if (real2 + imag2 > bailout) {
+            *norm = real2 + imag2;
+            break;
+        }
+        formula_step(&real, &imag, real2, imag2, c_real, c_imag, formula);
+        iter++;
+
+        if (detect_period) {
+            if (real == saved_real && imag == saved_imag) {
+                *periodic = 1;
+                return max_iter;
+            }
+            if (++period == power) {
+                period = 0;
+                power *= 2;
+                saved_real = real;
+                saved_imag = imag;
+            }
+        }
+    }
+    return iter;
+}
+
+// Mandelbrot 集的逃逸迭代次数
+int escape_time(REAL c_real, REAL c_imag, int max_iter) {
+    int periodic;
+    REAL norm;
+    return escape_loop(c_real, c_imag, c_real, c_imag, 4, max_iter, 0, 0, &periodic, &norm);
+}
+
+// 与 CPU 端 mandelbrot_escape_shortcut 完全相同的内部快捷路径, 坐标类型同样由 REAL 决定.
+// kind: 0 无捷径, 1 主心形, 2 周期 2 圆盘, 3 轨道循环
+int escape_shortcut(REAL c_real, REAL c_imag, int max_iter, int* kind) {
+    REAL q_real = c_real - (REAL)0.25;
+    REAL imag2 = c_imag * c_imag;
+    REAL q = q_real * q_real + imag2;
+    if (q * (q + q_real) < (REAL)0.25 * imag2) {
+        *kind = 1;
+        return max_iter;
+    }
+    REAL b_real = c_real + 1;
+    if (b_real * b_real + imag2 < (REAL)0.0625) {
+        *kind = 2;
+        return max_iter;
+    }
+
+    int periodic;
+    REAL norm;
+    int iter = escape_loop(c_real, c_imag, c_real, c_imag, 4, max_iter, 0, 1, &periodic, &norm);
+    *kind = periodic ? 3 : 0;
+    return iter;
+}
+
 __kernel void mandelbrot(__global uchar* output, const int width, const int height,
-                         const double x_start, const double x_finish,
-                         const double y_start, const double y_finish,
-                         const double center_x, const double center_y) {
+                         const REAL x_start, const REAL x_finish,
+                         const REAL y_start, const REAL y_finish,
+                         const REAL center_x, const REAL center_y, const int max_iter) {
     int x = get_global_id(0); 
     int y = get_global_id(1); 
 
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE) {
+        return;
+    }
+
+    REAL dx = (x_finish - x_start) / WIDTH_VALUE;
+    REAL dy = (y_finish - y_start) / HEIGHT_VALUE;
+    int iter = escape_time(x_start + x * dx, y_start + y * dy, ITER_LIMIT);
+
+    write_color(output, (y * WIDTH_VALUE + x) * 3, iter, ITER_LIMIT);
+}
+
+// 批量渲染: 同样大小的 count 张图像一次提交, get_global_id(2) 是图像序号.
+// views 中每张图像依次为 x_start, x_finish, y_start, y_finish, 输出按图像顺序紧密排列
+__kernel void mandelbrot_batch(__global uchar* output, const int width, const int height, const int count,
+                               __global const REAL* views, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+    int image = get_global_id(2);
+
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE || image >= count) {
+        return;
+    }
+
+    REAL x_start = views[image * 4];
+    REAL y_start = views[image * 4 + 2];
+    REAL dx = (views[image * 4 + 1] - x_start) / WIDTH_VALUE;
+    REAL dy = (views[image * 4 + 3] - y_start) / HEIGHT_VALUE;
+    int iter = escape_time(x_start + x * dx, y_start + y * dy, ITER_LIMIT);
+
+    write_color(output, ((image * HEIGHT_VALUE + y) * WIDTH_VALUE + x) * 3, iter, ITER_LIMIT);
+}
+
+// 输出视图版本: 像素格式与 CPU 端 PixelFormat 相同 (0 RGB8, 1 RGBA8, 2 uint16 迭代次数, 3 float 连续迭代次数).
+// 输出按 pixel_size 紧密排列, top_down 非 0 时行序颠倒, 主机端用 clEnqueueReadBufferRect 按目标行距直接读到最终位置
+__kernel void mandelbrot_view(__global uchar* output, const int width, const int height,
+                              const REAL x_start, const REAL x_finish,
+                              const REAL y_start, const REAL y_finish,
+                              const int max_iter, const int format, const int top_down) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE) {
+        return;
+    }
+
+    REAL dx = (x_finish - x_start) / WIDTH_VALUE;
+    REAL dy = (y_finish - y_start) / HEIGHT_VALUE;
+    REAL c_real = x_start + x * dx;
+    REAL c_imag = y_start + y * dy;
+
+    int periodic;
+    REAL norm;
+    int iter = escape_loop(c_real, c_imag, c_real, c_imag, 4, ITER_LIMIT, 0, 0, &periodic, &norm);
+    float smooth = iter < ITER_LIMIT ? (float)(iter + 1 - log2(0.5 * log((double)norm))) : (float)ITER_LIMIT;
+
+    int row = top_down ? HEIGHT_VALUE - 1 - y : y;
+    int index = row * WIDTH_VALUE + x;
+    if (format == 0) {
+        write_color(output, index * 3, iter, ITER_LIMIT);
+    } else if (format == 1) {
+        write_color_rgba(output, index, iter, ITER_LIMIT);
+    } else if (format == 2) {
+        ((__global ushort*)output)[index] = (ushort)iter;
+    } else {
+        ((__global float*)output)[index] = smooth;
+    }
+}
+
+// 只输出迭代次数 (每像素 2 字节), 着色在主机端查表完成
+__kernel void mandelbrot_field(__global ushort* iters, const int width, const int height,
+                               const REAL x_start, const REAL x_finish,
+                               const REAL y_start, const REAL y_finish, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE) {
+        return;
+    }
+
+    REAL dx = (x_finish - x_start) / WIDTH_VALUE;
+    REAL dy = (y_finish - y_start) / HEIGHT_VALUE;
+    int iter = escape_time(x_start + x * dx, y_start + y * dy, ITER_LIMIT);
+
+    iters[y * WIDTH_VALUE + x] = (ushort)iter;
+}
+
+// 与 CPU 端 antialias_jitter 相同的整数哈希
+double antialias_jitter(uint x, uint y, uint k) {
+    uint h = (x * 73856093u) ^ (y * 19349663u) ^ (k * 83492791u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xffffu) / 65536.0;
+}
+
+// 自适应抗锯齿第二遍: iters 为 mandelbrot_field 的结果, 与 8 邻域相差超过 threshold 的像素
+// 取 samples 个抖动子采样并平均颜色, 其余像素直接着色; counter[0] 统计超采样的像素数
+__kernel void mandelbrot_supersample(__global uchar* output, __global const ushort* iters, __global int* counter,
+                                     const int width, const int height,
+                                     const double x_start, const double x_finish,
+                                     const double y_start, const double y_finish,
+                                     const int samples, const int threshold, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
     if (x >= width || y >= height) {
         return;
     }
 
+    int center = iters[y * width + x];
+    bool edge = false;
+    for (int ny = max(0, y - 1); ny <= min(height - 1, y + 1); ++ny) {
+        for (int nx = max(0, x - 1); nx <= min(width - 1, x + 1); ++nx) {
+            int diff = iters[ny * width + nx] - center;
+            edge |= (diff > threshold || -diff > threshold);
+        }
+    }
+
+    int idx = (y * width + x) * 3;
+    if (!edge) {
+        write_color(output, idx, center, ITER_LIMIT);
+        return;
+    }
+
     double dx = (x_finish - x_start) / width;
     double dy = (y_finish - y_start) / height;
-    double real = x_start + x * dx;
-    double imag = y_start + y * dy;
+    int grid = 1;
+    while (grid * grid < samples) {
+        ++grid;
+    }
 
-    double c_real = real;
-    double c_imag = imag;
+    int sum[3] = {0, 0, 0};
+    for (int k = 0; k < samples; ++k) {
+        double sx = ((k % grid) + antialias_jitter(x, y, 2 * k)) / grid - 0.5;
+        double sy = ((k / grid % grid) + antialias_jitter(x, y, 2 * k + 1)) / grid - 0.5;
+        int iter = escape_time(x_start + (x + sx) * dx, y_start + (y + sy) * dy, ITER_LIMIT);
 
-    int max_iter = 256;
-    int iter = 0;
-    double real2, imag2;
+        uint color = color_rgb(iter, ITER_LIMIT);
+        for (int c = 0; c < 3; ++c) {
+            sum[c] += (color >> (8 * c)) & 0xffu;
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        output[idx + c] = (uchar)((sum[c] + samples / 2) / samples);
+    }
+    atomic_inc(counter);
+}
 
-    for (int i = 0; i < max_iter; ++i) {
-        real2 = real * real;
-        imag2 = imag * imag;
-        if (real2 + imag2 > 4.0) {
+// 微扰深度缩放: ref_orbit 为交错存放的参考轨道 (re, im), 每个像素只迭代相对参考轨道的差值.
+// pass > 0 时只重新计算上一轮被标记为 glitch 的像素 (使用次级参考点).
+__kernel void mandelbrot_perturb(__global uchar* output, __global uchar* glitch,
+                                 __global const double* ref_orbit, const int ref_last,
+                                 const int width, const int height,
+                                 const double dx, const double dy,
+                                 const double half_w, const double half_h,
+                                 const double offset_re, const double offset_im,
+                                 const int rebase, const double glitch_tolerance, const int pass, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= width || y >= height) {
+        return;
+    }
+
+    int pixel = y * width + x;
+    if (pass > 0 && glitch[pixel] == 0) {
+        return;
+    }
+
+    double dc_re = x * dx - half_w - offset_re;
+    double dc_im = y * dy - half_h - offset_im;
+
+    int iter = max_iter;
+    int glitched = 0;
+    double d_re = 0.0, d_im = 0.0;
+    int m = 0;
+
+    for (int k = 1; k <= max_iter; ++k) {
+        double z_re = ref_orbit[2 * m];
+        double z_im = ref_orbit[2 * m + 1];
+        double n_re = 2 * (z_re * d_re - z_im * d_im) + (d_re * d_re - d_im * d_im) + dc_re;
+        double n_im = 2 * (z_re * d_im + z_im * d_re) + 2 * d_re * d_im + dc_im;
+        d_re = n_re;
+        d_im = n_im;
+        ++m;
+
+        double r_re = ref_orbit[2 * m];
+        double r_im = ref_orbit[2 * m + 1];
+        z_re = r_re + d_re;
+        z_im = r_im + d_im;
+        double mag = z_re * z_re + z_im * z_im;
+        if (mag > 4) {
+            iter = k - 1;
+            break;
+        }
+
+        int is_glitch = mag < glitch_tolerance * (r_re * r_re + r_im * r_im);
+        int exhausted = (m == ref_last && k < max_iter);
+        if (rebase) {
+            if (is_glitch || exhausted || mag < d_re * d_re + d_im * d_im) {
+                d_re = z_re;
+                d_im = z_im;
+                m = 0;
+            }
+        } else if (is_glitch || exhausted) {
+            glitched = 1;
+            iter = k;
+            break;
+        }
+    }
+
+    glitch[pixel] = (uchar)glitched;
+    write_color(output, pixel * 3, iter, max_iter);
+}
+
+// 启用内部快捷路径的版本, counters[kind - 1] 统计每种捷径命中的像素数
+__kernel void mandelbrot_shortcut(__global uchar* output, __global int* counters,
+                                  const int width, const int height,
+                                  const REAL x_start, const REAL x_finish,
+                                  const REAL y_start, const REAL y_finish, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= width || y >= height) {
+        return;
+    }
+
+    REAL dx = (x_finish - x_start) / width;
+    REAL dy = (y_finish - y_start) / height;
+    REAL real = x_start + x * dx;
+    REAL imag = y_start + y * dy;
+
+    int kind;
+    int iter = escape_shortcut(real, imag, ITER_LIMIT, &kind);
+    if (kind > 0) {
+        atomic_inc(&counters[kind - 1]);
+    }
+
+    write_color(output, (y * width + x) * 3, iter, ITER_LIMIT);
+}
+
+// double-double 版本: 数值为 (hi, lo) 两个 double 之和, 用于 double 精度不足的深度缩放.
+// 与 CPU 端 main_doubledouble.cpp 使用相同的无误差变换, 乘法误差由 fma 精确给出
+double2 dd_two_sum(double a, double b) {
+    double s = a + b;
+    double bb = s - a;
+    return (double2)(s, (a - (s - bb)) + (b - bb));
+}
+
+double2 dd_quick_two_sum(double a, double b) {
+    double s = a + b;
+    return (double2)(s, b - (s - a));
+}
+
+double2 dd_add(double2 a, double2 b) {
+    double2 s = dd_two_sum(a.x, b.x);
+    double2 t = dd_two_sum(a.y, b.y);
+    s.y += t.x;
+    s = dd_quick_two_sum(s.x, s.y);
+    s.y += t.y;
+    return dd_quick_two_sum(s.x, s.y);
+}
+
+double2 dd_mul(double2 a, double2 b) {
+    double p = a.x * b.x;
+    double e = fma(a.x, b.x, -p);
+    e += a.x * b.y + a.y * b.x;
+    return dd_quick_two_sum(p, e);
+}
+
+double2 dd_mul_d(double2 a, double b) {
+    double p = a.x * b;
+    double e = fma(a.x, b, -p);
+    e += a.y * b;
+    return dd_quick_two_sum(p, e);
+}
+
+// x_start, y_start 为视口左下角, dx, dy 为像素间距, 都以 double-double 传入, 在主机端算好以免在设备上做除法
+__kernel void mandelbrot_dd(__global uchar* output, const int width, const int height,
+                            const double2 x_start, const double2 dx,
+                            const double2 y_start, const double2 dy, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE) {
+        return;
+    }
+
+    double2 c_real = dd_add(x_start, dd_mul_d(dx, (double)x));
+    double2 c_imag = dd_add(y_start, dd_mul_d(dy, (double)y));
+    double2 real = c_real;
+    double2 imag = c_imag;
+
+    int iter = 0;
+    for (int i = 0; i < ITER_LIMIT; ++i) {
+        double2 real2 = dd_mul(real, real);
+        double2 imag2 = dd_mul(imag, imag);
+        // 与 CPU 端 dd_real 的比较相同: 先比较高位, 高位相等时再看低位
+        double2 norm = dd_add(real2, imag2);
+        if (norm.x > 4.0 || (norm.x == 4.0 && norm.y > 0.0)) {
             break;
         }
-        imag = 2 * real * imag + c_imag;
-        real = real2 - imag2 + c_real;
+        imag = dd_add(dd_mul(real * 2.0, imag), c_imag);
+        real = dd_add(dd_add(real2, -imag2), c_real);
         iter++;
     }
 
-    double t = (double)iter / max_iter;
-    uchar r, g, b;
+    write_color(output, (y * WIDTH_VALUE + x) * 3, iter, ITER_LIMIT);
+}
 
-    if (iter == max_iter) {
-        r = g = b = 0; // 黑色
-    } else {
-        double t1 = 1 - t;
-        r = (uchar)(9 * t1 * t * t * t * 255);
-        g = (uchar)(15 * t1 * t1 * t * t * 255);
-        b = (uchar)(8.5 * t1 * t1 * t1 * t * 255);
+// 与 CPU 端 fractal_omp 相同的逃逸时间公式族; Julia 集时 julia_real, julia_imag 为参数 c, 其余公式忽略
+__kernel void fractal(__global uchar* output, const int width, const int height,
+                      const REAL x_start, const REAL x_finish,
+                      const REAL y_start, const REAL y_finish,
+                      const REAL julia_real, const REAL julia_imag, const int max_iter) {
+    int x = get_global_id(0);
+    int y = get_global_id(1);
+
+    if (x >= WIDTH_VALUE || y >= HEIGHT_VALUE) {
+        return;
     }
 
-    int idx = (y * width + x) * 3;
-    output[idx] = r;
-    output[idx + 1] = g;
-    output[idx + 2] = b;
+    REAL dx = (x_finish - x_start) / WIDTH_VALUE;
+    REAL dy = (y_finish - y_start) / HEIGHT_VALUE;
+    REAL real = x_start + x * dx;
+    REAL imag = y_start + y * dy;
+
+#if FORMULA == 1
+    REAL c_real = julia_real;
+    REAL c_imag = julia_imag;
+    // 逃逸半径取 max(2, |c|)
+    REAL bailout = fmax((REAL)4, c_real * c_real + c_imag * c_imag);
+#else
+    REAL c_real = real;
+    REAL c_imag = imag;
+    const REAL bailout = 4;
+#endif
+
+    int periodic;
+    REAL norm;
+    int iter = escape_loop(real, imag, c_real, c_imag, bailout, ITER_LIMIT, FORMULA, 0, &periodic, &norm);
+
+    write_color(output, (y * WIDTH_VALUE + x) * 3, iter, ITER_LIMIT);
 }
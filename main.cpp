@@ -8,9 +8,23 @@
 #include <fstream>
 #include <filesystem>
 #include <chrono>
+#include <memory>
 
 #include "main_openmp.cpp"
 #include "main_opencl.cpp"
+#include "main_simd.cpp"
+#include "main_perturbation.cpp"
+#include "main_scheduler.cpp"
+#include "main_incremental.cpp"
+#include "main_palette.cpp"
+#include "main_progressive.cpp"
+#include "main_maxiter.cpp"
+#include "main_antialias.cpp"
+#include "main_tilecache.cpp"
+#include "main_multidevice.cpp"
+#include "main_hybrid.cpp"
+#include "main_doubledouble.cpp"
+#include "main_autotune.cpp"
 
 #define WIDTH 800
 #define HEIGHT 600
@@ -40,7 +54,7 @@
 //     glDisable(GL_TEXTURE_2D);
 // }
 
-void renderImage(uint8_t* output, GLuint texture) {
+void renderImage(const uint8_t* output, GLuint texture) {
     glBindTexture(GL_TEXTURE_2D, texture);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, output);
 
@@ -99,13 +113,35 @@ void initOpenGL(GLFWwindow*& window, GLuint& texture) {
 }
 
 template<typename T>
-void computeMandelbrot(int choice, uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, MandelbrotOpenCL& mandelbrotOpenCL) {
+void computeMandelbrot(int choice, uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, MandelbrotOpenCL* mandelbrotOpenCL,
+                       ShortcutStats* shortcuts = nullptr, int max_iter = 256) {
     if (choice == 1) {
-        mandelbrot_single_thread(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+        mandelbrot_single_thread(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, shortcuts, max_iter);
     } else if (choice == 2) {
-        mandelbrot_omp(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y);
+        mandelbrot_omp(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, shortcuts, max_iter);
     } else if (choice == 3) {
-        mandelbrotOpenCL.compute(output, x_start, x_finish, y_start, y_finish, center_x, center_y);
+        mandelbrotOpenCL->compute(output, x_start, x_finish, y_start, y_finish, center_x, center_y, shortcuts, max_iter);
+    } else if (choice == 4) {
+        // SIMD 引擎只有 float 和 double 版本
+        if constexpr (std::is_floating_point<T>::value) {
+            mandelbrot_simd(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+        }
+    } else if (choice == 7) {
+        mandelbrot_omp_tiled(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, shortcuts, max_iter);
+    }
+}
+
+// 深度缩放模式直接使用 (center, scale), 不经过会丢失精度的 x_start/x_finish
+void computeDeepZoom(int choice, bool use_double, uint8_t* output, int width, int height, const dd_real& center_x, const dd_real& center_y, double scale, double ratio,
+                     MandelbrotOpenCL* mandelbrotOpenCL, int max_iter) {
+    if (choice == 5) {
+        if (use_double) {
+            mandelbrot_perturbation<double>(output, width, height, center_x, center_y, scale, ratio, PerturbationOptions(), nullptr, max_iter);
+        } else {
+            mandelbrot_perturbation<float>(output, width, height, center_x, center_y, scale, ratio, PerturbationOptions(), nullptr, max_iter);
+        }
+    } else if (choice == 6) {
+        mandelbrotOpenCL->computePerturbation(output, center_x, center_y, scale, ratio, PerturbationOptions(), nullptr, max_iter);
     }
 }
 
@@ -118,7 +154,7 @@ int main() {
     std::cout << "Current working directory: " << std::filesystem::current_path() << std::endl;
 
     int choice;
-    std::cout << "Choose mode: 1. Single Thread 2. OpenMP 3. OpenCL" << std::endl;
+    std::cout << "Choose mode: 1. Single Thread 2. OpenMP 3. OpenCL 4. SIMD 5. Deep Zoom (OpenMP) 6. Deep Zoom (OpenCL) 7. OpenMP (work stealing) 8. Incremental (OpenMP) 9. OpenCL (async double-buffered) 10. Palette LUT (OpenMP field) 11. Palette LUT (OpenCL field) 12. Progressive (OpenMP) 13. Anti-aliased (OpenMP) 14. Anti-aliased (OpenCL) 15. Tile cache (OpenMP) 16. Multi-device OpenCL 17. Hybrid (OpenMP + OpenCL) 18. Auto (calibrated engine and precision)" << std::endl;
     std::cin >> choice;
 
     switch (choice) {
@@ -131,15 +167,81 @@ int main() {
         case 3:
             std::cout << "OpenCL" << std::endl;
             break;
+        case 4:
+            std::cout << "SIMD (" << simd_level_name(simd_level()) << ")" << std::endl;
+            break;
+        case 5:
+            std::cout << "Deep Zoom (OpenMP perturbation)" << std::endl;
+            break;
+        case 6:
+            std::cout << "Deep Zoom (OpenCL perturbation)" << std::endl;
+            break;
+        case 7:
+            std::cout << "OpenMP (work-stealing tiles of " << default_tile_scheduler().tileSize() << ")" << std::endl;
+            break;
+        case 8:
+            std::cout << "Incremental (OpenMP, exact reuse), press F to toggle full recompute, A to toggle approximate reuse" << std::endl;
+            break;
+        case 9:
+            std::cout << "OpenCL (async double-buffered)" << std::endl;
+            break;
+        case 10:
+            std::cout << "Palette LUT (OpenMP iteration field), press P to cycle palettes" << std::endl;
+            break;
+        case 11:
+            std::cout << "Palette LUT (OpenCL iteration field), press P to cycle palettes" << std::endl;
+            break;
+        case 12:
+            std::cout << "Progressive (OpenMP), press SPACE to pause zoom and refine to full resolution" << std::endl;
+            break;
+        case 13:
+            std::cout << "Anti-aliased (OpenMP, 8 samples on edge pixels)" << std::endl;
+            break;
+        case 14:
+            std::cout << "Anti-aliased (OpenCL, 8 samples on edge pixels)" << std::endl;
+            break;
+        case 15:
+            std::cout << "Tile cache (OpenMP), tiles persisted to tiles.bin" << std::endl;
+            break;
+        case 16:
+            std::cout << "Multi-device OpenCL (row bands rebalanced every frame)" << std::endl;
+            break;
+        case 17:
+            std::cout << "Hybrid (OpenCL and OpenMP render one frame together)" << std::endl;
+            break;
+        case 18:
+            std::cout << "Auto (engine, precision, tile and work-group size calibrated per viewport class, saved in autotune.profile)" << std::endl;
+            break;
         default:
             std::cerr << "Invalid choice" << std::endl;
             exit(1);
     }
 
-    int precision_choice;
-    std::cout << "Choose precision: 1. Float 2. Double (default)" << std::endl;
-    std::cin >> precision_choice;
+    // 自动模式按视口深度自己选择精度
+    int precision_choice = 2;
+    if (choice != 18) {
+        std::cout << "Choose precision: 1. Float 2. Double (default) 3. Double-double (modes 1, 2, 3, 7)" << std::endl;
+        std::cin >> precision_choice;
+    }
     bool use_double = (precision_choice != 1);
+    bool use_dd = (precision_choice == 3);
+    if (use_dd && !(choice <= 3 || choice == 7)) {
+        std::cout << "Double-double is only available in modes 1, 2, 3 and 7, using double" << std::endl;
+        use_dd = false;
+    }
+
+    int shortcut_choice = 2;
+    if (choice <= 3 || choice == 7) {
+        std::cout << "Enable interior shortcuts (cardioid/bulb/periodicity): 1. Yes 2. No (default)" << std::endl;
+        std::cin >> shortcut_choice;
+    }
+    ShortcutStats shortcuts;
+    ShortcutStats* shortcuts_ptr = (shortcut_choice == 1) ? &shortcuts : nullptr;
+
+    // 所有模式的迭代上限都随缩放深度增长; 模式 10/11 改为根据上一帧的迭代直方图调整
+    bool adaptive_iter = true;
+    int max_iter = 256;
+    MaxIterController max_iter_controller;
 
     double x_start = -2.0, x_finish = 2.0;
     double y_start = -1.5, y_finish = 1.5;
@@ -162,19 +264,216 @@ int main() {
 
     std::vector<uint8_t> output(WIDTH * HEIGHT * 3);
 
-    MandelbrotOpenCL mandelbrotOpenCL(WIDTH, HEIGHT);
+    // 只在用到 OpenCL 的模式下创建, 没有 OpenCL 设备的机器仍可使用 CPU 模式; 自动模式探测不到设备时只考虑 CPU 配置
+    bool uses_opencl = (choice == 3 || choice == 6 || choice == 9 || choice == 11 || choice == 14 || choice == 17);
+    std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+    if (uses_opencl || (choice == 18 && opencl_available())) {
+        mandelbrotOpenCL.reset(new MandelbrotOpenCL(WIDTH, HEIGHT));
+    }
+
+    // 增量模式: 默认只精确复用整数像素平移的采样; 按 A 切换近似复用 (半个像素以内), 输出可能与完整重算不同
+    const double approximate_tolerance = 0.5;
+    IncrementalRenderer<double> incremental_double(WIDTH, HEIGHT);
+    IncrementalRenderer<float> incremental_float(WIDTH, HEIGHT);
+    bool force_full = false;
+    bool f_was_pressed = false;
+    bool a_was_pressed = false;
+    long long reused_pixels = 0;
+
+    // 异步模式: 第 N+1 帧在设备上计算时, 主机显示第 N 帧
+    MandelbrotOpenCL::AsyncFrame pending_frame;
+    bool has_pending_frame = false;
+
+    // 调色板模式: 引擎只输出迭代场, 按 P 切换调色板时不需要重新计算迭代
+    std::vector<uint16_t> field(WIDTH * HEIGHT);
+    Palette::Kind palette_kind = Palette::CLASSIC;
+    Palette palette(palette_kind);
+    bool p_was_pressed = false;
+
+    // 渐进模式: 每帧在时间预算内尽量细化, 视口改变时放弃未完成的细化
+    ProgressiveRenderer<double> progressive_double(WIDTH, HEIGHT, 16);
+    ProgressiveRenderer<float> progressive_float(WIDTH, HEIGHT, 16);
+    const double refine_budget = 1.0 / 60;
+    bool paused = false;
+    bool space_was_pressed = false;
+    bool viewport_changed = true;
+
+    // 抗锯齿模式: 只对与邻域迭代次数相差超过阈值的像素做 8 倍抖动超采样
+    const int aa_samples = 8;
+    const int aa_threshold = 2;
+    AntialiasStats antialias;
+    double supersampled_fraction = 0.0;
+
+    // tile 缓存模式: 内存中最多 256 MB, 淘汰的 tile 写入 tiles.bin, 下次启动可以直接读回
+    std::unique_ptr<TileCache> tile_cache;
+    if (choice == 15) {
+        tile_cache.reset(new TileCache(256u << 20, "tiles.bin"));
+    }
+
+    // 多设备模式: 使用所有平台上的全部 OpenCL 设备 (GPU 和 CPU 运行时)
+    std::unique_ptr<MultiDeviceOpenCL> multi_device;
+    if (choice == 16) {
+        DeviceSelection selection;
+        selection.type = CL_DEVICE_TYPE_ALL;
+        multi_device.reset(new MultiDeviceOpenCL(WIDTH, HEIGHT, selection));
+        for (int i = 0; i < multi_device->deviceCount(); ++i) {
+            std::cout << "Device " << i << ": " << multi_device->deviceName(i) << std::endl;
+        }
+    }
+
+    // 协同模式: 分界行按两边的吞吐量和上一帧的代价图每帧调整
+    std::unique_ptr<HybridRenderer> hybrid;
+    if (choice == 17) {
+        hybrid.reset(new HybridRenderer(WIDTH, HEIGHT, *mandelbrotOpenCL));
+    }
+    HybridStats hybrid_stats;
+
+    // 自动模式: 视口类别改变时切换到该类别的校准结果, 第一次遇到某个类别时校准
+    std::unique_ptr<AutoTuner> autotuner;
+    if (choice == 18) {
+        autotuner.reset(new AutoTuner(WIDTH, HEIGHT, mandelbrotOpenCL.get()));
+    }
+    int tuned_view = -1;
 
     while (!glfwWindowShouldClose(window)) {
-        updateParameters(scale, x_start, x_finish, y_start, y_finish, center_x, center_y, ratio, zoom_factor);
+        if (choice == 12) {
+            bool space_pressed = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
+            if (space_pressed && !space_was_pressed) {
+                paused = !paused;
+                std::cout << (paused ? "Paused" : "Zooming") << std::endl;
+            }
+            space_was_pressed = space_pressed;
+        }
+        if (!paused) {
+            updateParameters(scale, x_start, x_finish, y_start, y_finish, center_x, center_y, ratio, zoom_factor);
+            viewport_changed = true;
+        }
+        if (adaptive_iter && choice != 10 && choice != 11) {
+            max_iter = adaptive_max_iter(scale);
+        }
 
-        if (use_double) {
-            computeMandelbrot(choice, output.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, mandelbrotOpenCL);
+        if (choice == 8) {
+            bool f_pressed = glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS;
+            if (f_pressed && !f_was_pressed) {
+                force_full = !force_full;
+                std::cout << (force_full ? "Full recompute" : "Incremental reuse") << std::endl;
+            }
+            f_was_pressed = f_pressed;
+            bool a_pressed = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+            if (a_pressed && !a_was_pressed) {
+                double tolerance = incremental_double.approximate() ? 0.0 : approximate_tolerance;
+                incremental_double.setTolerance(tolerance);
+                incremental_float.setTolerance(tolerance);
+                std::cout << (tolerance > 0 ? "Approximate reuse (samples within half a pixel, may differ from full recompute)" : "Exact reuse (whole-pixel shifts only)")
+                          << std::endl;
+            }
+            a_was_pressed = a_pressed;
+
+            if (use_double) {
+                incremental_double.setForceFull(force_full);
+                incremental_double.render(output.data(), x_start, x_finish, y_start, y_finish, max_iter);
+                reused_pixels += incremental_double.reusedPixels();
+            } else {
+                incremental_float.setForceFull(force_full);
+                incremental_float.render(output.data(), static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), max_iter);
+                reused_pixels += incremental_float.reusedPixels();
+            }
+        } else if (choice == 10 || choice == 11) {
+            bool p_pressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+            if (p_pressed && !p_was_pressed) {
+                palette_kind = static_cast<Palette::Kind>((palette_kind + 1) % Palette::COUNT);
+                palette = Palette(palette_kind, max_iter);
+                std::cout << "Palette: " << Palette::name(palette_kind) << std::endl;
+            }
+            p_was_pressed = p_pressed;
+
+            if (choice == 11) {
+                mandelbrotOpenCL->computeField(field.data(), x_start, x_finish, y_start, y_finish, max_iter);
+            } else if (use_double) {
+                mandelbrot_field(field.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+            } else {
+                mandelbrot_field(field.data(), WIDTH, HEIGHT, static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), max_iter);
+            }
+            if (palette.maxIter() != max_iter) {
+                palette = Palette(palette_kind, max_iter);
+            }
+            colorize(field.data(), WIDTH * HEIGHT, palette, output.data());
+            max_iter = max_iter_controller.update(field.data(), WIDTH * HEIGHT, scale);
+        } else if (choice == 12) {
+            if (viewport_changed) {
+                progressive_double.begin(x_start, x_finish, y_start, y_finish, max_iter);
+                progressive_float.begin(static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), max_iter);
+                viewport_changed = false;
+            }
+            // 第一遍总是完成, 以保证每帧都有图像; 之后的细化受时间预算限制
+            auto refine_start = std::chrono::high_resolution_clock::now();
+            bool done;
+            do {
+                done = use_double ? progressive_double.refine(output.data()) : progressive_float.refine(output.data());
+            } while (!done && std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - refine_start).count() < refine_budget);
+        } else if (choice == 13 || choice == 14) {
+            if (choice == 14) {
+                mandelbrotOpenCL->computeAntialias(output.data(), x_start, x_finish, y_start, y_finish, aa_samples, aa_threshold, &antialias, max_iter);
+            } else if (use_double) {
+                mandelbrot_antialias(output.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, aa_samples, aa_threshold, &antialias, max_iter);
+            } else {
+                mandelbrot_antialias(output.data(), WIDTH, HEIGHT, static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), aa_samples, aa_threshold, &antialias, max_iter);
+            }
+            supersampled_fraction += antialias.fraction;
+        } else if (choice == 15) {
+            tile_cache->render(output.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, max_iter);
+        } else if (choice == 17) {
+            if (use_double) {
+                hybrid->compute(output.data(), x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+            } else {
+                hybrid->compute(output.data(), static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), max_iter);
+            }
+            hybrid_stats = hybrid->stats();
+        } else if (choice == 16) {
+            if (use_double) {
+                multi_device->compute(output.data(), x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+            } else {
+                multi_device->compute(output.data(), static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), max_iter);
+            }
+        } else if (choice == 18) {
+            ViewportClass view = viewport_class(scale, HEIGHT);
+            const TuneChoice& tuned = autotuner->choose(view);
+            if (view != tuned_view) {
+                std::cout << "Viewport class " << viewport_class_name(view) << ": " << tuned.describe() << std::endl;
+                tuned_view = view;
+            }
+            autotuner->render(output.data(), tuned, center_x, center_y, scale, ratio, max_iter);
+        } else if (choice == 5 || choice == 6) {
+            computeDeepZoom(choice, use_double, output.data(), WIDTH, HEIGHT, dd_real(center_x), dd_real(center_y), scale, ratio, mandelbrotOpenCL.get(), max_iter);
+        } else if (use_dd) {
+            // 视口由中心和缩放直接以 double-double 计算, 不经过 1e-16 以下已经丢失精度的 x_start/x_finish
+            dd_real half_w = 0.5 * ratio * scale;
+            dd_real half_h = 0.5 * scale;
+            computeMandelbrot(choice, output.data(), WIDTH, HEIGHT, dd_real(center_x) - half_w, dd_real(center_x) + half_w, dd_real(center_y) - half_h,
+                              dd_real(center_y) + half_h, dd_real(center_x), dd_real(center_y), mandelbrotOpenCL.get(), shortcuts_ptr, max_iter);
+        } else if (use_double) {
+            computeMandelbrot(choice, output.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, mandelbrotOpenCL.get(), shortcuts_ptr, max_iter);
         } else {
-            computeMandelbrot(choice, output.data(), WIDTH, HEIGHT, static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), mandelbrotOpenCL);
+            computeMandelbrot(choice, output.data(), WIDTH, HEIGHT, static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), mandelbrotOpenCL.get(), shortcuts_ptr, max_iter);
         }
 
-        // 渲染图片
-        renderImage(output.data(), texture);
+        if (choice == 9) {
+            MandelbrotOpenCL::AsyncFrame frame;
+            if (use_double) {
+                frame = mandelbrotOpenCL->computeAsync(x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+            } else {
+                frame = mandelbrotOpenCL->computeAsync(static_cast<float>(x_start), static_cast<float>(x_finish), static_cast<float>(y_start), static_cast<float>(y_finish), static_cast<float>(center_x), static_cast<float>(center_y), max_iter);
+            }
+            if (has_pending_frame) {
+                renderImage(mandelbrotOpenCL->waitFrame(pending_frame), texture);
+                mandelbrotOpenCL->releaseFrame(pending_frame);
+            }
+            pending_frame = frame;
+            has_pending_frame = true;
+        } else {
+            // 渲染图片
+            renderImage(output.data(), texture);
+        }
 
         // 显示 FPS
         frame_count++;
@@ -183,6 +482,37 @@ int main() {
         if (elapsed.count() >= 1.0f) {
             double fps = frame_count / elapsed.count();
             std::cout << "FPS: " << fps << std::endl;
+            if (adaptive_iter) {
+                std::cout << "Max iterations: " << max_iter << std::endl;
+            }
+            if (shortcuts_ptr) {
+                std::cout << "Shortcut pixels per frame: cardioid " << shortcuts.cardioid / frame_count
+                          << ", bulb " << shortcuts.bulb / frame_count
+                          << ", periodic " << shortcuts.periodic / frame_count << std::endl;
+                shortcuts = ShortcutStats();
+            }
+            if (choice == 13 || choice == 14) {
+                std::cout << "Supersampled pixels: " << 100.0 * supersampled_fraction / frame_count << "%" << std::endl;
+                supersampled_fraction = 0.0;
+            }
+            if (choice == 15) {
+                const TileCacheStats& stats = tile_cache->stats();
+                std::cout << "Tiles: " << stats.hits << " hits, " << stats.disk_hits << " disk hits, " << stats.misses << " misses" << std::endl;
+                tile_cache->resetStats();
+            }
+            if (choice == 16) {
+                for (int i = 0; i < multi_device->deviceCount(); ++i) {
+                    std::cout << "Device " << i << ": " << multi_device->bands()[i] << " rows, last frame " << 1000.0 * multi_device->lastTimes()[i] << " ms" << std::endl;
+                }
+            }
+            if (choice == 17) {
+                std::cout << "OpenCL rows: " << hybrid_stats.split << "/" << HEIGHT << " (OpenCL " << 1000.0 * hybrid_stats.opencl_seconds
+                          << " ms, OpenMP " << 1000.0 * hybrid_stats.cpu_seconds << " ms, next OpenCL share " << 100.0 * hybrid_stats.opencl_share << "%)" << std::endl;
+            }
+            if (choice == 8) {
+                std::cout << (incremental_double.approximate() ? "Reused pixels (approximate): " : "Reused pixels: ") << 100.0 * reused_pixels / (static_cast<double>(frame_count) * WIDTH * HEIGHT) << "%" << std::endl;
+                reused_pixels = 0;
+            }
             frame_count = 0;
             last_time = current_time;
         }
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+#include "main_palette.cpp"
+
+// 自适应抗锯齿: 先按原分辨率算出迭代场, 只有与 8 邻域的迭代次数相差超过 threshold 的像素
+// 才在像素范围内取 samples 个抖动子采样并平均颜色, 工作量与边界长度成正比而不是与面积成正比.
+struct AntialiasStats {
+    long long supersampled = 0;   // 做了超采样的像素数
+    double fraction = 0.0;        // 占全部像素的比例
+};
+
+// 分层抖动: 子采样落在 g x g 网格的格子里, 格内偏移由整数哈希决定, CPU 与 OpenCL 结果一致
+inline double antialias_jitter(uint32_t x, uint32_t y, uint32_t k) {
+    uint32_t h = (x * 73856093u) ^ (y * 19349663u) ^ (k * 83492791u);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return (h & 0xffffu) / 65536.0;
+}
+
+inline int antialias_grid(int samples) {
+    int grid = 1;
+    while (grid * grid < samples) {
+        ++grid;
+    }
+    return grid;
+}
+
+inline bool antialias_edge(const uint16_t* iters, int width, int height, int x, int y, int threshold) {
+    int center = iters[y * width + x];
+    for (int ny = std::max(0, y - 1); ny <= std::min(height - 1, y + 1); ++ny) {
+        for (int nx = std::max(0, x - 1); nx <= std::min(width - 1, x + 1); ++nx) {
+            int diff = iters[ny * width + nx] - center;
+            if (diff > threshold || -diff > threshold) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template<typename T>
+void mandelbrot_antialias(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y,
+                          int samples = 8, int threshold = 2, AntialiasStats* stats = nullptr, int max_iter = 256) {
+    T dx = (x_finish - x_start) / width;
+    T dy = (y_finish - y_start) / height;
+    std::vector<uint16_t> iters(width * height);
+    mandelbrot_field(iters.data(), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+
+    int grid = antialias_grid(samples);
+    long long supersampled = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:supersampled)
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            uint8_t* pixel = output + (y * width + x) * 3;
+            if (!antialias_edge(iters.data(), width, height, x, y, threshold)) {
+                mandelbrot_color(iters[y * width + x], max_iter, pixel);
+                continue;
+            }
+
+            // 采样点位于像素中心, 子采样覆盖 [x - 0.5, x + 0.5) x [y - 0.5, y + 0.5)
+            int sum[3] = {0, 0, 0};
+            for (int k = 0; k < samples; ++k) {
+                double sx = ((k % grid) + antialias_jitter(x, y, 2 * k)) / grid - 0.5;
+                double sy = ((k / grid % grid) + antialias_jitter(x, y, 2 * k + 1)) / grid - 0.5;
+                T real = x_start + static_cast<T>(x + sx) * dx;
+                T imag = y_start + static_cast<T>(y + sy) * dy;
+                uint8_t color[3];
+                mandelbrot_color(mandelbrot_escape(real, imag, max_iter), max_iter, color);
+                sum[0] += color[0];
+                sum[1] += color[1];
+                sum[2] += color[2];
+            }
+            for (int c = 0; c < 3; ++c) {
+                pixel[c] = static_cast<uint8_t>((sum[c] + samples / 2) / samples);
+            }
+            ++supersampled;
+        }
+    }
+
+    if (stats) {
+        stats->supersampled = supersampled;
+        stats->fraction = static_cast<double>(supersampled) / (static_cast<double>(width) * height);
+    }
+}
@@ -0,0 +1,298 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+#include "main_scheduler.cpp"
+#include "main_opencl.cpp"
+#include "main_doubledouble.cpp"
+
+// 启动时自动调优: 第一次遇到某类视口时用几帧短校准渲染比较候选配置 (引擎, 精度, tile 大小, OpenCL 工作组形状),
+// 结果以硬件为键写入 profile 文件, 之后启动直接读取. 没有 OpenCL 设备时只在 CPU 配置中选择.
+// 视口按像素间距分类, 只比较精度足够的配置: 间距远大于 float / double 的舍入误差时才允许使用它们
+enum ViewportClass {
+    VIEW_WIDE = 0,    // float 足够
+    VIEW_DEEP = 1,    // 需要 double
+    VIEW_ULTRA = 2    // 需要 double-double
+};
+
+inline ViewportClass viewport_class(double scale, int height) {
+    // |c| 不超过 2, 像素间距至少为该处 16 个 ulp
+    double pixel = scale / height;
+    if (pixel > 16 * 2.4e-7) {
+        return VIEW_WIDE;
+    }
+    if (pixel > 16 * 4.5e-16) {
+        return VIEW_DEEP;
+    }
+    return VIEW_ULTRA;
+}
+
+inline const char* viewport_class_name(ViewportClass view) {
+    switch (view) {
+        case VIEW_WIDE: return "wide";
+        case VIEW_DEEP: return "deep";
+        default: return "ultra";
+    }
+}
+
+struct TuneChoice {
+    std::string engine = "omp";         // omp | tiled | opencl
+    std::string precision = "double";   // float | double | dd
+    int tile_size = 0;                  // tiled 引擎的 tile 边长
+    int local_x = 0, local_y = 0;       // OpenCL 工作组形状, 0 表示由驱动选择
+    double seconds = 0.0;               // 校准帧耗时 (取最小值)
+
+    std::string describe() const {
+        std::ostringstream text;
+        text << engine << " (" << precision;
+        if (engine == "tiled") {
+            text << ", tile " << tile_size;
+        } else if (engine == "opencl") {
+            text << ", work-group " << (local_x > 0 ? std::to_string(local_x) + "x" + std::to_string(local_y) : std::string("default"));
+        }
+        text << ")";
+        return text.str();
+    }
+};
+
+inline std::string cpu_model() {
+    std::ifstream in("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.compare(0, 10, "model name") == 0) {
+            size_t colon = line.find(':');
+            return colon == std::string::npos ? line : line.substr(colon + 2);
+        }
+    }
+    return "unknown cpu";
+}
+
+class AutoTuner {
+public:
+    // opencl 为空时不考虑 OpenCL 配置
+    AutoTuner(int width, int height, MandelbrotOpenCL* opencl, const std::string& path = "autotune.profile")
+        : width(width), height(height), opencl(opencl), path(path), scratch(width * height * 3) {
+        std::string hardware = cpu_model() + "\n" + std::to_string(omp_get_max_threads());
+        if (opencl) {
+            hardware += "\n" + opencl->deviceName() + "\n" + opencl->driverVersion();
+        }
+        std::ostringstream key;
+        key << std::hex << fnv1a_hash(hardware) << std::dec << " " << width << "x" << height;
+        hardwareKey = key.str();
+    }
+
+    // 第一次调用某个类别时可能需要几秒钟校准
+    const TuneChoice& choose(ViewportClass view) {
+        auto it = choices.find(view);
+        if (it != choices.end()) {
+            return it->second;
+        }
+        TuneChoice choice;
+        if (!load(view, choice)) {
+            std::cout << "Calibrating " << viewport_class_name(view) << " viewports..." << std::endl;
+            choice = calibrate(view);
+            save(view, choice);
+        }
+        return choices.emplace(view, choice).first->second;
+    }
+
+    // 视口直接由中心和缩放给出, double-double 配置不经过丢失精度的 x_start/x_finish
+    void render(uint8_t* output, const TuneChoice& choice, double center_x, double center_y, double scale, double ratio, int max_iter) {
+        if (choice.precision == "dd") {
+            dd_real half_w = 0.5 * ratio * scale;
+            dd_real half_h = 0.5 * scale;
+            renderWith(output, choice, dd_real(center_x) - half_w, dd_real(center_x) + half_w, dd_real(center_y) - half_h, dd_real(center_y) + half_h,
+                       dd_real(center_x), dd_real(center_y), max_iter);
+        } else if (choice.precision == "float") {
+            renderWith(output, choice, static_cast<float>(center_x - 0.5 * ratio * scale), static_cast<float>(center_x + 0.5 * ratio * scale),
+                       static_cast<float>(center_y - 0.5 * scale), static_cast<float>(center_y + 0.5 * scale), static_cast<float>(center_x),
+                       static_cast<float>(center_y), max_iter);
+        } else {
+            renderWith(output, choice, center_x - 0.5 * ratio * scale, center_x + 0.5 * ratio * scale, center_y - 0.5 * scale, center_y + 0.5 * scale, center_x,
+                       center_y, max_iter);
+        }
+    }
+
+private:
+    int width, height;
+    MandelbrotOpenCL* opencl;
+    std::string path;
+    std::string hardwareKey;   // 硬件哈希与分辨率
+    std::map<int, TuneChoice> choices;
+    std::vector<uint8_t> scratch;
+
+    template<typename T>
+    void renderWith(uint8_t* output, const TuneChoice& choice, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter) {
+        if (choice.engine == "opencl" && opencl) {
+            // 渲染时的迭代上限可能对应另一个内核变体, 它的工作组上限不够时交给驱动选择
+            bool fits = static_cast<size_t>(choice.local_x * choice.local_y) <= opencl->maxWorkGroupSize<T>(max_iter);
+            opencl->setWorkGroup(fits ? choice.local_x : 0, fits ? choice.local_y : 0);
+            opencl->compute(output, x_start, x_finish, y_start, y_finish, center_x, center_y, nullptr, max_iter);
+        } else if (choice.engine == "tiled") {
+            // 改变 tile 大小会丢掉调度器积累的代价图, 只在需要时设置
+            if (default_tile_scheduler().tileSize() != choice.tile_size) {
+                default_tile_scheduler().setTileSize(choice.tile_size);
+            }
+            mandelbrot_omp_tiled(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, nullptr, max_iter);
+        } else {
+            mandelbrot_omp(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, nullptr, max_iter);
+        }
+    }
+
+    // 工作组上限按每种精度实际提交的内核分别检查
+    size_t workGroupLimit(const std::string& precision, int max_iter) const {
+        if (precision == "dd") {
+            return opencl->maxWorkGroupSize<dd_real>(max_iter);
+        }
+        if (precision == "float") {
+            return opencl->maxWorkGroupSize<float>(max_iter);
+        }
+        return opencl->maxWorkGroupSize<double>(max_iter);
+    }
+
+    std::vector<TuneChoice> candidates(ViewportClass view, int max_iter) const {
+        std::vector<std::string> precisions;
+        if (view == VIEW_WIDE) {
+            precisions = {"float", "double"};
+        } else if (view == VIEW_DEEP) {
+            precisions = {"double"};
+        } else {
+            precisions = {"dd"};
+        }
+
+        std::vector<TuneChoice> result;
+        for (const std::string& precision : precisions) {
+            TuneChoice choice;
+            choice.precision = precision;
+            choice.engine = "omp";
+            result.push_back(choice);
+            choice.engine = "tiled";
+            for (int tile : {16, 32, 64}) {
+                choice.tile_size = tile;
+                result.push_back(choice);
+            }
+            choice.tile_size = 0;
+            if (opencl) {
+                choice.engine = "opencl";
+                size_t limit = workGroupLimit(precision, max_iter);
+                for (auto shape : std::vector<std::pair<int, int>>{{0, 0}, {8, 8}, {16, 16}, {32, 8}, {64, 4}, {128, 1}, {256, 1}}) {
+                    if (static_cast<size_t>(shape.first * shape.second) > limit) {
+                        continue;
+                    }
+                    choice.local_x = shape.first;
+                    choice.local_y = shape.second;
+                    result.push_back(choice);
+                }
+                choice.local_x = choice.local_y = 0;
+            }
+        }
+        return result;
+    }
+
+    // 每个候选先渲染一帧预热 (含 OpenCL 变体编译), 再计时两帧取最小值; 预热帧已慢于当前最优 3 倍的候选直接跳过.
+    // 校准视口是边界上的一点, 迭代上限固定为 512, 只用于比较相对快慢
+    TuneChoice calibrate(ViewportClass view) {
+        const double center_x = -0.748766710846959, center_y = 0.123640847970064;
+        const double scales[] = {0.01, 1e-9, 1e-20};
+        double scale = scales[view];
+        double ratio = static_cast<double>(width) / height;
+        const int max_iter = 512;
+
+        TuneChoice best;
+        best.seconds = 1e30;
+        for (TuneChoice candidate : candidates(view, max_iter)) {
+            auto frame = [&]() {
+                auto start = std::chrono::high_resolution_clock::now();
+                render(scratch.data(), candidate, center_x, center_y, scale, ratio, max_iter);
+                return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            };
+            if (frame() > 3 * best.seconds) {
+                continue;
+            }
+            candidate.seconds = std::min(frame(), frame());
+            std::cout << "  " << candidate.describe() << ": " << 1000.0 * candidate.seconds << " ms" << std::endl;
+            if (candidate.seconds < best.seconds) {
+                best = candidate;
+            }
+        }
+        if (opencl) {
+            opencl->setWorkGroup(0, 0);
+        }
+        return best;
+    }
+
+    // 每行: 硬件哈希 分辨率 类别 引擎 精度 tile 工作组宽 工作组高 秒
+    bool load(ViewportClass view, TuneChoice& choice) const {
+        std::ifstream in(path);
+        std::string line;
+        std::string prefix = hardwareKey + " " + viewport_class_name(view) + " ";
+        while (std::getline(in, line)) {
+            if (line.compare(0, prefix.size(), prefix) != 0) {
+                continue;
+            }
+            std::istringstream fields(line.substr(prefix.size()));
+            TuneChoice loaded;
+            if (!(fields >> loaded.engine >> loaded.precision >> loaded.tile_size >> loaded.local_x >> loaded.local_y >> loaded.seconds)) {
+                continue;
+            }
+            // 硬件相同但 OpenCL 设备已不可用时, 旧结果作废
+            if (loaded.engine == "opencl" && !opencl) {
+                continue;
+            }
+            choice = loaded;
+            return true;
+        }
+        return false;
+    }
+
+    void save(ViewportClass view, const TuneChoice& choice) const {
+        std::string prefix = hardwareKey + " " + viewport_class_name(view) + " ";
+        std::vector<std::string> lines;
+        {
+            std::ifstream in(path);
+            std::string line;
+            while (std::getline(in, line)) {
+                if (!line.empty() && line.compare(0, prefix.size(), prefix) != 0) {
+                    lines.push_back(line);
+                }
+            }
+        }
+        std::ostringstream entry;
+        entry << prefix << choice.engine << " " << choice.precision << " " << choice.tile_size << " " << choice.local_x << " " << choice.local_y << " "
+              << choice.seconds;
+        lines.push_back(entry.str());
+
+        // 与程序二进制缓存相同, 先写各自的临时文件再改名
+        std::string temporary = temporary_path(path);
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            if (!out.is_open()) {
+                std::cerr << "Failed to write autotune profile: " << path << std::endl;
+                return;
+            }
+            for (const std::string& line : lines) {
+                out << line << "\n";
+            }
+            out.close();
+            if (!out) {
+                std::cerr << "Failed to write autotune profile: " << path << std::endl;
+                std::error_code error;
+                std::filesystem::remove(temporary, error);
+                return;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+        }
+    }
+};
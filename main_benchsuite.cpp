@@ -0,0 +1,204 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+// 基准测试套件的公共部分: 场景表, 重复测量的统计量, JSON / CSV 输出以及与基线比较.
+// 场景以 (中心, 视口高度, 迭代上限) 描述, frames > 1 的场景是一段连续缩放, 每次测量渲染全部帧.
+struct BenchScenario {
+    std::string name;
+    double center_x, center_y;
+    double scale;        // 视口高度, 宽度按分辨率的宽高比
+    int max_iter;
+    int frames = 1;
+    double zoom = 1.0;   // 每帧视口高度的缩放系数
+};
+
+inline std::vector<BenchScenario> bench_scenarios() {
+    return {
+        {"wide", -0.5, 0.0, 3.0, 256},
+        {"boundary", -0.748766710846959, 0.123640847970064, 0.01, 1024},
+        {"interior", -0.2, 0.0, 0.5, 256},
+        {"deep", -0.748766710846959, 0.123640847970064, 1e-12, 4096},
+        {"zoom", -0.748766710846959, 0.123640847970064, 3.0, 512, 30, 0.8},
+    };
+}
+
+struct BenchStats {
+    double median = 0.0;
+    double p95 = 0.0;
+    double mean = 0.0;
+    double stddev = 0.0;
+    double min = 0.0;
+};
+
+inline BenchStats bench_stats(std::vector<double> samples) {
+    BenchStats stats;
+    if (samples.empty()) {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.min = samples[0];
+    stats.median = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    // 最近秩法, 样本少时 p95 就是最大值
+    stats.p95 = samples[std::min(n - 1, static_cast<size_t>(std::ceil(0.95 * n)) - 1)];
+    double sum = 0.0;
+    for (double s : samples) {
+        sum += s;
+    }
+    stats.mean = sum / n;
+    double squares = 0.0;
+    for (double s : samples) {
+        squares += (s - stats.mean) * (s - stats.mean);
+    }
+    stats.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    return stats;
+}
+
+// 先预热 warmup 次 (不计时), 再计时 repeats 次, 每次单独计时
+template<typename Render>
+BenchStats bench_run(Render render, int warmup, int repeats) {
+    for (int i = 0; i < warmup; ++i) {
+        render();
+    }
+    std::vector<double> samples;
+    for (int i = 0; i < repeats; ++i) {
+        auto start = std::chrono::high_resolution_clock::now();
+        render();
+        samples.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+    }
+    return bench_stats(samples);
+}
+
+struct BenchResult {
+    std::string scenario;
+    std::string engine;
+    int width = 0, height = 0;
+    int threads = 0;               // OpenCL 引擎为 0
+    int repeats = 0;
+    BenchStats seconds;            // 每次测量 (场景的全部帧) 的耗时
+    double pixels_per_second = 0.0;
+    double iterations_per_second = 0.0;
+
+    // 比较时用于匹配基线中同一条记录
+    std::string key() const {
+        return scenario + "/" + engine + "/" + std::to_string(width) + "x" + std::to_string(height) + "/" + std::to_string(threads);
+    }
+};
+
+inline void write_bench_json(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open output file: " << path << std::endl;
+        exit(1);
+    }
+    out << std::setprecision(9) << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        out << "  {\"scenario\": \"" << r.scenario << "\", \"engine\": \"" << r.engine << "\", \"width\": " << r.width << ", \"height\": " << r.height
+            << ", \"threads\": " << r.threads << ", \"repeats\": " << r.repeats << ", \"median\": " << r.seconds.median << ", \"p95\": " << r.seconds.p95
+            << ", \"mean\": " << r.seconds.mean << ", \"stddev\": " << r.seconds.stddev << ", \"min\": " << r.seconds.min
+            << ", \"pixels_per_second\": " << r.pixels_per_second << ", \"iterations_per_second\": " << r.iterations_per_second << "}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]\n";
+}
+
+static const char* BENCH_CSV_HEADER = "scenario,engine,width,height,threads,repeats,median,p95,mean,stddev,min,pixels_per_second,iterations_per_second";
+
+inline void write_bench_csv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open output file: " << path << std::endl;
+        exit(1);
+    }
+    out << std::setprecision(9) << BENCH_CSV_HEADER << "\n";
+    for (const BenchResult& r : results) {
+        out << r.scenario << "," << r.engine << "," << r.width << "," << r.height << "," << r.threads << "," << r.repeats << "," << r.seconds.median << ","
+            << r.seconds.p95 << "," << r.seconds.mean << "," << r.seconds.stddev << "," << r.seconds.min << "," << r.pixels_per_second << ","
+            << r.iterations_per_second << "\n";
+    }
+}
+
+inline std::vector<BenchResult> read_bench_csv(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Failed to open baseline file: " << path << std::endl;
+        exit(1);
+    }
+    std::vector<BenchResult> results;
+    std::string line;
+    std::getline(in, line);
+    if (line != BENCH_CSV_HEADER) {
+        std::cerr << "Unrecognised baseline format: " << path << std::endl;
+        exit(1);
+    }
+    while (std::getline(in, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> fields;
+        std::stringstream row(line);
+        std::string field;
+        while (std::getline(row, field, ',')) {
+            fields.push_back(field);
+        }
+        if (fields.size() != 13) {
+            std::cerr << "Malformed baseline row: " << line << std::endl;
+            exit(1);
+        }
+        BenchResult r;
+        r.scenario = fields[0];
+        r.engine = fields[1];
+        r.width = std::stoi(fields[2]);
+        r.height = std::stoi(fields[3]);
+        r.threads = std::stoi(fields[4]);
+        r.repeats = std::stoi(fields[5]);
+        r.seconds.median = std::stod(fields[6]);
+        r.seconds.p95 = std::stod(fields[7]);
+        r.seconds.mean = std::stod(fields[8]);
+        r.seconds.stddev = std::stod(fields[9]);
+        r.seconds.min = std::stod(fields[10]);
+        r.pixels_per_second = std::stod(fields[11]);
+        r.iterations_per_second = std::stod(fields[12]);
+        results.push_back(r);
+    }
+    return results;
+}
+
+// 中位数变慢超过 tolerance (相对值), 且超出两次测量的噪声 (两边标准差之和) 时判为回归.
+// 返回回归的记录数
+inline int compare_bench_results(const std::vector<BenchResult>& current, const std::vector<BenchResult>& baseline, double tolerance) {
+    std::map<std::string, BenchResult> previous;
+    for (const BenchResult& r : baseline) {
+        previous[r.key()] = r;
+    }
+
+    int regressions = 0;
+    std::cout << std::left << std::setw(40) << "case" << std::right << std::setw(14) << "baseline (s)" << std::setw(14) << "current (s)" << std::setw(10) << "change"
+              << std::endl;
+    for (const BenchResult& r : current) {
+        auto it = previous.find(r.key());
+        if (it == previous.end()) {
+            std::cout << std::left << std::setw(40) << r.key() << std::right << std::setw(14) << "-" << std::setw(14) << r.seconds.median << "   (new)" << std::endl;
+            continue;
+        }
+        const BenchResult& base = it->second;
+        double change = r.seconds.median / base.seconds.median - 1.0;
+        double noise = r.seconds.stddev + base.seconds.stddev;
+        bool regressed = change > tolerance && r.seconds.median - base.seconds.median > noise;
+        regressions += regressed;
+        std::cout << std::left << std::setw(40) << r.key() << std::right << std::setw(14) << base.seconds.median << std::setw(14) << r.seconds.median
+                  << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * change << "%" << std::defaultfloat << std::setprecision(6)
+                  << (regressed ? "  REGRESSION" : "") << std::endl;
+    }
+    return regressions;
+}
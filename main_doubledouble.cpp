@@ -0,0 +1,129 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+// double-double: 数值表示为两个不重叠的 double 之和 hi + lo, 约 106 位有效位.
+// |c| 接近 2 时舍入误差约 2.5e-32, 600 行的视口可以缩放到约 1e-28 (相邻像素相距约 1.7e-31);
+// 再深 1-2 个数量级相邻像素的坐标开始重合, 见 benchmark 的 check_dd_resolution. 只实现 Mandelbrot 模板需要的运算,
+// 可以直接作为 mandelbrot_escape / mandelbrot_omp 等模板的 T 使用.
+// 无误差变换: two_sum 给出 a + b 的精确舍入误差, two_prod 用 FMA 给出 a * b 的精确舍入误差.
+inline double dd_two_sum(double a, double b, double& error) {
+    double sum = a + b;
+    double bb = sum - a;
+    error = (a - (sum - bb)) + (b - bb);
+    return sum;
+}
+
+// 要求 |a| >= |b|
+inline double dd_quick_two_sum(double a, double b, double& error) {
+    double sum = a + b;
+    error = b - (sum - a);
+    return sum;
+}
+
+inline double dd_two_prod(double a, double b, double& error) {
+    double product = a * b;
+#ifdef FP_FAST_FMA
+    error = std::fma(a, b, -product);
+#else
+    // 没有硬件 FMA 时 std::fma 是软件实现, 改用 Dekker 拆分
+    const double split = 134217729.0;   // 2^27 + 1
+    double t = split * a;
+    double a_hi = t - (t - a);
+    double a_lo = a - a_hi;
+    t = split * b;
+    double b_hi = t - (t - b);
+    double b_lo = b - b_hi;
+    error = ((a_hi * b_hi - product) + a_hi * b_lo + a_lo * b_hi) + a_lo * b_lo;
+#endif
+    return product;
+}
+
+struct dd_real {
+    double hi, lo;
+
+    dd_real() : hi(0.0), lo(0.0) {}
+    dd_real(double value) : hi(value), lo(0.0) {}
+    dd_real(int value) : hi(value), lo(0.0) {}
+    dd_real(double hi, double lo) : hi(hi), lo(lo) {}
+
+    explicit operator double() const { return hi + lo; }
+};
+
+inline dd_real operator+(const dd_real& a, const dd_real& b) {
+    double e1, e2;
+    double s = dd_two_sum(a.hi, b.hi, e1);
+    double t = dd_two_sum(a.lo, b.lo, e2);
+    e1 += t;
+    s = dd_quick_two_sum(s, e1, e1);
+    e1 += e2;
+    s = dd_quick_two_sum(s, e1, e1);
+    return dd_real(s, e1);
+}
+
+inline dd_real operator-(const dd_real& a) {
+    return dd_real(-a.hi, -a.lo);
+}
+
+inline dd_real operator-(const dd_real& a, const dd_real& b) {
+    return a + (-b);
+}
+
+inline dd_real operator*(const dd_real& a, const dd_real& b) {
+    double error;
+    double product = dd_two_prod(a.hi, b.hi, error);
+    error += a.hi * b.lo + a.lo * b.hi;
+    product = dd_quick_two_sum(product, error, error);
+    return dd_real(product, error);
+}
+
+inline dd_real operator*(double a, const dd_real& b) {
+    double error;
+    double product = dd_two_prod(a, b.hi, error);
+    error += a * b.lo;
+    product = dd_quick_two_sum(product, error, error);
+    return dd_real(product, error);
+}
+
+inline dd_real operator*(const dd_real& a, double b) {
+    return b * a;
+}
+
+// 乘 2 是精确的, 迭代中的 2 * real * imag 不需要完整的乘法
+inline dd_real operator*(int a, const dd_real& b) {
+    if (a == 2) {
+        return dd_real(2.0 * b.hi, 2.0 * b.lo);
+    }
+    return static_cast<double>(a) * b;
+}
+
+inline dd_real operator/(const dd_real& a, const dd_real& b) {
+    // 长除法: 先用 double 估计商, 再用余数修正一次
+    double q1 = a.hi / b.hi;
+    dd_real r = a - q1 * b;
+    double q2 = r.hi / b.hi;
+    r = r - q2 * b;
+    double q3 = r.hi / b.hi;
+    double error;
+    q1 = dd_quick_two_sum(q1, q2, error);
+    return dd_real(q1, error) + dd_real(q3);
+}
+
+inline dd_real operator/(const dd_real& a, double b) {
+    return a / dd_real(b);
+}
+
+inline dd_real operator/(const dd_real& a, int b) {
+    return a / dd_real(b);
+}
+
+inline dd_real& operator+=(dd_real& a, const dd_real& b) { return a = a + b; }
+inline dd_real& operator-=(dd_real& a, const dd_real& b) { return a = a - b; }
+inline dd_real& operator*=(dd_real& a, const dd_real& b) { return a = a * b; }
+
+inline bool operator==(const dd_real& a, const dd_real& b) { return a.hi == b.hi && a.lo == b.lo; }
+inline bool operator!=(const dd_real& a, const dd_real& b) { return !(a == b); }
+inline bool operator<(const dd_real& a, const dd_real& b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+inline bool operator>(const dd_real& a, const dd_real& b) { return b < a; }
+inline bool operator<=(const dd_real& a, const dd_real& b) { return !(b < a); }
+inline bool operator>=(const dd_real& a, const dd_real& b) { return !(a < b); }
@@ -0,0 +1,183 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <type_traits>
+
+// 逃逸时间公式族: 每个公式是一个策略类型, 给出初值 (z0, c) 和一步迭代, 引擎模板按公式实例化,
+// 热循环中没有按公式的运行时分支. step 收到本步已经算好的 real^2 和 imag^2, 与逃逸判断共用.
+struct MandelbrotFormula {
+    template<typename T>
+    void start(T x, T y, T& real, T& imag, T& c_real, T& c_imag) const {
+        real = c_real = x;
+        imag = c_imag = y;
+    }
+
+    double bailout() const { return 4.0; }
+
+    template<typename T>
+    void step(T& real, T& imag, T real2, T imag2, T c_real, T c_imag) const {
+        imag = 2 * real * imag + c_imag;
+        real = real2 - imag2 + c_real;
+    }
+};
+
+// Julia 集: z0 为像素坐标, c 为固定参数; 逃逸半径取 max(2, |c|)
+struct JuliaFormula {
+    double c_real, c_imag;
+
+    JuliaFormula(double c_real, double c_imag) : c_real(c_real), c_imag(c_imag) {}
+
+    template<typename T>
+    void start(T x, T y, T& real, T& imag, T& cr, T& ci) const {
+        real = x;
+        imag = y;
+        cr = T(c_real);
+        ci = T(c_imag);
+    }
+
+    double bailout() const {
+        double norm = c_real * c_real + c_imag * c_imag;
+        return norm > 4.0 ? norm : 4.0;
+    }
+
+    template<typename T>
+    void step(T& real, T& imag, T real2, T imag2, T cr, T ci) const {
+        imag = 2 * real * imag + ci;
+        real = real2 - imag2 + cr;
+    }
+};
+
+// z^Power + c, Power 为编译期常量, 幂次用展开的复数乘法计算
+template<int Power>
+struct MultibrotFormula {
+    static_assert(Power >= 2, "Multibrot power must be at least 2");
+
+    template<typename T>
+    void start(T x, T y, T& real, T& imag, T& c_real, T& c_imag) const {
+        real = c_real = x;
+        imag = c_imag = y;
+    }
+
+    double bailout() const { return 4.0; }
+
+    template<typename T>
+    void step(T& real, T& imag, T real2, T imag2, T c_real, T c_imag) const {
+        // z^2 直接由 real2, imag2 得到, 其余各次逐次乘 z
+        T power_real = real2 - imag2;
+        T power_imag = 2 * real * imag;
+        for (int k = 2; k < Power; ++k) {
+            T next = power_real * real - power_imag * imag;
+            power_imag = power_real * imag + power_imag * real;
+            power_real = next;
+        }
+        real = power_real + c_real;
+        imag = power_imag + c_imag;
+    }
+};
+
+// Burning Ship: 每步先取实部和虚部的绝对值再平方
+struct BurningShipFormula {
+    template<typename T>
+    void start(T x, T y, T& real, T& imag, T& c_real, T& c_imag) const {
+        real = c_real = x;
+        imag = c_imag = y;
+    }
+
+    double bailout() const { return 4.0; }
+
+    template<typename T>
+    void step(T& real, T& imag, T real2, T imag2, T c_real, T c_imag) const {
+        T product = real * imag;
+        imag = 2 * (product < T(0) ? -product : product) + c_imag;
+        real = real2 - imag2 + c_real;
+    }
+};
+
+// 通用逃逸循环, 与 mandelbrot_escape 的结构相同
+template<typename Formula, typename T>
+inline int formula_escape(const Formula& formula, T x, T y, int max_iter) {
+    T real, imag, c_real, c_imag;
+    formula.start(x, y, real, imag, c_real, c_imag);
+    const double bailout = formula.bailout();
+    int iter = 0;
+    T real2, imag2;
+
+    for (int i = 0; i < max_iter; ++i) {
+        real2 = real * real;
+        imag2 = imag * imag;
+        if (real2 + imag2 > bailout) {
+            break;
+        }
+        formula.step(real, imag, real2, imag2, c_real, c_imag);
+        iter++;
+    }
+    return iter;
+}
+
+// 运行时选择的分形, 由 with_formula 分派到上面的编译期策略
+enum FractalKind {
+    FRACTAL_MANDELBROT = 0,
+    FRACTAL_JULIA = 1,
+    FRACTAL_MULTIBROT = 2,
+    FRACTAL_BURNING_SHIP = 3
+};
+
+static const int MULTIBROT_MAX_POWER = 8;
+
+struct FractalSpec {
+    FractalKind kind = FRACTAL_MANDELBROT;
+    int power = 2;             // Multibrot 的幂次, 2..MULTIBROT_MAX_POWER
+    double julia_real = -0.8;  // Julia 集的参数 c
+    double julia_imag = 0.156;
+};
+
+inline FractalKind parse_fractal_kind(const std::string& text) {
+    if (text == "mandelbrot") return FRACTAL_MANDELBROT;
+    if (text == "julia") return FRACTAL_JULIA;
+    if (text == "multibrot") return FRACTAL_MULTIBROT;
+    if (text == "burning-ship") return FRACTAL_BURNING_SHIP;
+    std::cerr << "Unknown fractal: " << text << std::endl;
+    exit(1);
+}
+
+inline const char* fractal_name(FractalKind kind) {
+    switch (kind) {
+        case FRACTAL_MANDELBROT: return "mandelbrot";
+        case FRACTAL_JULIA: return "julia";
+        case FRACTAL_MULTIBROT: return "multibrot";
+        default: return "burning-ship";
+    }
+}
+
+template<int Power, typename Body>
+inline void with_multibrot_power(int power, Body& body) {
+    if constexpr (Power <= MULTIBROT_MAX_POWER) {
+        if (power == Power) {
+            body(MultibrotFormula<Power>());
+        } else {
+            with_multibrot_power<Power + 1>(power, body);
+        }
+    } else {
+        std::cerr << "Multibrot power must be between 2 and " << MULTIBROT_MAX_POWER << ", got " << power << std::endl;
+        exit(1);
+    }
+}
+
+// body 收到公式对象, 在 body 内实例化的循环只包含这一种公式
+template<typename Body>
+inline void with_formula(const FractalSpec& spec, Body body) {
+    switch (spec.kind) {
+        case FRACTAL_MANDELBROT: body(MandelbrotFormula()); break;
+        case FRACTAL_JULIA: body(JuliaFormula(spec.julia_real, spec.julia_imag)); break;
+        case FRACTAL_MULTIBROT:
+            // 幂次 2 就是 Mandelbrot 集, 走同一个实现
+            if (spec.power == 2) {
+                body(MandelbrotFormula());
+            } else {
+                with_multibrot_power<3>(spec.power, body);
+            }
+            break;
+        default: body(BurningShipFormula()); break;
+    }
+}
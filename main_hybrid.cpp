@@ -0,0 +1,113 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+#include "main_palette.cpp"
+#include "main_opencl.cpp"
+
+// CPU + OpenCL 协同渲染同一帧: OpenCL 计算 [0, split) 行, OpenMP 同时计算 [split, height) 行.
+// 两边都输出迭代场, 合并后一次查表着色, 这样整帧的迭代次数就是下一帧的代价图.
+// 分界行按代价图选择, 使两边按各自测得的吞吐量 (迭代次数/秒) 同时完成.
+struct HybridStats {
+    int split = 0;              // 本帧 OpenCL 负责的行数
+    double opencl_seconds = 0.0;
+    double cpu_seconds = 0.0;
+    double opencl_share = 0.0;  // 下一帧分给 OpenCL 的代价比例
+};
+
+class HybridRenderer {
+public:
+    HybridRenderer(int width, int height, MandelbrotOpenCL& opencl, double smoothing = 0.5)
+        : width(width), height(height), smoothing(smoothing), opencl(opencl), iters(width * height), row_cost(height),
+          split(height / 2), opencl_rate(0.0), cpu_rate(0.0) {}
+
+    const HybridStats& stats() const { return last; }
+
+    // OpenCL 部分总是以双精度计算, 与 MandelbrotOpenCL::computeField 相同
+    template<typename T>
+    void compute(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+        int opencl_rows = split;
+        double opencl_seconds = 0.0;
+        std::thread device([&]() {
+            auto start = std::chrono::high_resolution_clock::now();
+            opencl.computeFieldRows(iters.data(), 0, opencl_rows, x_start, x_finish, y_start, y_finish, max_iter);
+            opencl_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        });
+
+        auto start = std::chrono::high_resolution_clock::now();
+        T dx = (x_finish - x_start) / width;
+        T dy = (y_finish - y_start) / height;
+        with_max_iter(max_iter, [&](auto limit) {
+            #pragma omp parallel for schedule(dynamic)
+            for (int y = opencl_rows; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    T real = x_start + x * dx;
+                    T imag = y_start + y * dy;
+                    iters[y * width + x] = static_cast<uint16_t>(mandelbrot_escape(real, imag, limit));
+                }
+            }
+        });
+        double cpu_seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        device.join();
+
+        if (palette.maxIter() != max_iter) {
+            palette = Palette(Palette::CLASSIC, max_iter);
+        }
+        colorize(iters.data(), width * height, palette, output);
+
+        last.split = opencl_rows;
+        last.opencl_seconds = opencl_seconds;
+        last.cpu_seconds = cpu_seconds;
+        rebalance(opencl_rows, opencl_seconds, cpu_seconds);
+        last.opencl_share = opencl_rate / (opencl_rate + cpu_rate);
+    }
+
+private:
+    int width, height;
+    double smoothing;
+    MandelbrotOpenCL& opencl;
+    std::vector<uint16_t> iters;
+    std::vector<double> row_cost;
+    Palette palette;
+    int split;
+    double opencl_rate, cpu_rate;   // 平滑后的吞吐量, 单位为迭代次数/秒
+    HybridStats last;
+
+    void rebalance(int opencl_rows, double opencl_seconds, double cpu_seconds) {
+        // 每个像素另计一次迭代的固定开销, 全部逃逸的行代价也不为零
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            double cost = width;
+            for (int x = 0; x < width; ++x) {
+                cost += iters[y * width + x];
+            }
+            row_cost[y] = cost;
+        }
+
+        double opencl_cost = 0.0, total = 0.0;
+        for (int y = 0; y < height; ++y) {
+            total += row_cost[y];
+            if (y < opencl_rows) {
+                opencl_cost += row_cost[y];
+            }
+        }
+        double measured_opencl = opencl_cost / std::max(opencl_seconds, 1e-6);
+        double measured_cpu = (total - opencl_cost) / std::max(cpu_seconds, 1e-6);
+        opencl_rate = opencl_rate > 0.0 ? smoothing * opencl_rate + (1.0 - smoothing) * measured_opencl : measured_opencl;
+        cpu_rate = cpu_rate > 0.0 ? smoothing * cpu_rate + (1.0 - smoothing) * measured_cpu : measured_cpu;
+
+        // 缩放是连续的, 本帧的代价图近似下一帧; 两边各至少保留一行以便继续测量吞吐量
+        double target = total * opencl_rate / (opencl_rate + cpu_rate);
+        double prefix = 0.0;
+        int next = 0;
+        while (next < height && prefix + row_cost[next] * 0.5 < target) {
+            prefix += row_cost[next];
+            ++next;
+        }
+        split = std::min(std::max(next, 1), height - 1);
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <omp.h>
+#include "main_openmp.cpp"
+
+// 复用上一帧的采样: 每个像素保存迭代次数和实际采样坐标.
+// 默认 tolerance = 0 为精确模式: 只在缩放比例不变 (平移整数个像素) 时复用, 且只复用坐标完全相同的采样,
+// 结果与完整重算逐字节一致. tolerance > 0 为近似模式 (需显式开启): 复用距离不超过 tolerance 个像素的采样,
+// 缩放时也能复用, 但边界附近的像素会与完整重算不同.
+template<typename T>
+class IncrementalRenderer {
+public:
+    IncrementalRenderer(int width, int height, double tolerance = 0.0)
+        : width(width), height(height), tolerance(tolerance), force_full(false), valid(false),
+          iters(width * height), sample_re(width * height), sample_im(width * height),
+          next_iters(width * height), next_re(width * height), next_im(width * height),
+          prev_x_start(0), prev_y_start(0), prev_dx(1), prev_dy(1), prev_max_iter(0), reused(0), computed(0) {}
+
+    void setTolerance(double pixels) { tolerance = pixels; }
+    double getTolerance() const { return tolerance; }
+    bool approximate() const { return tolerance > 0; }
+
+    // 强制完整重算, 用于验证增量结果
+    void setForceFull(bool force) { force_full = force; }
+    bool getForceFull() const { return force_full; }
+
+    void invalidate() { valid = false; }
+
+    long long reusedPixels() const { return reused; }
+    long long computedPixels() const { return computed; }
+
+    void render(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, int max_iter = 256) {
+        T dx = (x_finish - x_start) / width;
+        T dy = (y_finish - y_start) / height;
+        // 迭代上限变化后旧的迭代次数不再有效; 精确模式下缩放比例一变, 采样网格就不再重合, 不必查找
+        bool reuse = valid && !force_full && max_iter == prev_max_iter && (tolerance > 0 || (dx == prev_dx && dy == prev_dy));
+        T tol_x = static_cast<T>(tolerance) * dx;
+        T tol_y = static_cast<T>(tolerance) * dy;
+        long long reused_count = 0;
+
+        #pragma omp parallel for schedule(dynamic) reduction(+:reused_count)
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+                int idx = y * width + x;
+
+                if (reuse) {
+                    // 复用过的采样坐标会偏离上一帧的网格, 因此在最近像素的 3x3 邻域内找最近的采样
+                    int old_x = static_cast<int>(std::floor((real - prev_x_start) / prev_dx + T(0.5)));
+                    int old_y = static_cast<int>(std::floor((imag - prev_y_start) / prev_dy + T(0.5)));
+                    int best = -1;
+                    T best_dist = 0;
+                    for (int ny = old_y - 1; ny <= old_y + 1; ++ny) {
+                        for (int nx = old_x - 1; nx <= old_x + 1; ++nx) {
+                            if (nx < 0 || nx >= width || ny < 0 || ny >= height) {
+                                continue;
+                            }
+                            int old = ny * width + nx;
+                            T err_x = std::fabs(sample_re[old] - real);
+                            T err_y = std::fabs(sample_im[old] - imag);
+                            if (err_x <= tol_x && err_y <= tol_y && (best < 0 || err_x + err_y < best_dist)) {
+                                best = old;
+                                best_dist = err_x + err_y;
+                            }
+                        }
+                    }
+                    if (best >= 0) {
+                        next_iters[idx] = iters[best];
+                        next_re[idx] = sample_re[best];
+                        next_im[idx] = sample_im[best];
+                        ++reused_count;
+                        continue;
+                    }
+                }
+
+                next_iters[idx] = mandelbrot_escape(real, imag, max_iter);
+                next_re[idx] = real;
+                next_im[idx] = imag;
+            }
+        }
+
+        iters.swap(next_iters);
+        sample_re.swap(next_re);
+        sample_im.swap(next_im);
+        prev_x_start = x_start;
+        prev_y_start = y_start;
+        prev_dx = dx;
+        prev_dy = dy;
+        prev_max_iter = max_iter;
+        valid = true;
+        reused = reused_count;
+        computed = static_cast<long long>(width) * height - reused_count;
+
+        #pragma omp parallel for
+        for (int i = 0; i < width * height; ++i) {
+            mandelbrot_color(iters[i], max_iter, output + i * 3);
+        }
+    }
+
+private:
+    int width, height;
+    double tolerance;
+    bool force_full;
+    bool valid;
+    std::vector<int> iters;
+    std::vector<T> sample_re, sample_im;
+    std::vector<int> next_iters;
+    std::vector<T> next_re, next_im;
+    T prev_x_start, prev_y_start, prev_dx, prev_dy;
+    int prev_max_iter;
+    long long reused, computed;
+};
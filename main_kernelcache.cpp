@@ -0,0 +1,152 @@
+#pragma once
+#define CL_HPP_TARGET_OPENCL_VERSION 300
+#define CL_HPP_ENABLE_EXCEPTIONS
+#include <CL/opencl.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <thread>
+#include <functional>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+// 程序二进制缓存: 以设备名, 驱动版本, 内核源码哈希和编译选项为键, 把设备相关的程序二进制存到磁盘.
+// 任何一项变化都会得到新的键, 旧文件不会被误用; 二进制加载或构建失败时退回源码编译并覆盖缓存.
+struct KernelCacheStats {
+    int hits = 0;     // 直接从二进制加载的程序数
+    int misses = 0;   // 从源码编译的程序数
+};
+
+inline uint64_t fnv1a_hash(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// 先写临时文件再改名时使用的临时文件名. 名字包含进程号和线程号, 同一目标的多个写入者
+// (并发启动的进程, 多设备引擎中同时构建同一变体的线程) 各写各的文件, 不会改名到别人正在写的文件
+inline std::string temporary_path(const std::string& path) {
+    std::ostringstream name;
+#ifdef _WIN32
+    int pid = _getpid();
+#else
+    int pid = getpid();
+#endif
+    name << path << "." << pid << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+    return name.str();
+}
+
+class KernelCache {
+public:
+    // directory 为空时不读写磁盘, 每次都从源码编译
+    explicit KernelCache(const std::string& directory = "kernel_cache") : directory(directory) {}
+
+    const KernelCacheStats& stats() const { return counters; }
+
+    // 删除所有缓存的二进制, 用于测量冷启动
+    void clear() {
+        if (directory.empty()) {
+            return;
+        }
+        std::error_code error;
+        std::filesystem::remove_all(directory, error);
+    }
+
+    std::string key(const cl::Device& device, const std::string& source, const std::string& options) const {
+        std::string identity = device.getInfo<CL_DEVICE_NAME>() + '\n' + device.getInfo<CL_DEVICE_VERSION>() + '\n' + device.getInfo<CL_DRIVER_VERSION>();
+        std::ostringstream name;
+        name << std::hex << std::setfill('0') << std::setw(16) << fnv1a_hash(identity) << '-' << std::setw(16) << fnv1a_hash(source) << '-'
+             << std::setw(16) << fnv1a_hash(options);
+        return name.str();
+    }
+
+    cl::Program build(const cl::Context& context, const cl::Device& device, const std::string& source, const std::string& options) {
+        std::string path;
+        if (!directory.empty()) {
+            path = directory + "/" + key(device, source, options) + ".bin";
+            cl::Program program;
+            if (loadBinary(context, device, path, options, program)) {
+                ++counters.hits;
+                return program;
+            }
+        }
+
+        ++counters.misses;
+        cl::Program::Sources sources;
+        sources.push_back({source.c_str(), source.length()});
+        cl::Program program(context, sources);
+        try {
+            program.build({device}, options.c_str());
+        } catch (const cl::Error&) {
+            std::cerr << "Error building: " << program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
+            exit(1);
+        }
+        if (!path.empty()) {
+            storeBinary(program, path);
+        }
+        return program;
+    }
+
+private:
+    std::string directory;
+    KernelCacheStats counters;
+
+    bool loadBinary(const cl::Context& context, const cl::Device& device, const std::string& path, const std::string& options, cl::Program& program) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+        cl::Program::Binaries binaries(1);
+        binaries[0].assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (binaries[0].empty()) {
+            return false;
+        }
+        // 驱动可能拒绝旧格式的二进制, 这时当作未命中处理
+        try {
+            program = cl::Program(context, {device}, binaries);
+            program.build({device}, options.c_str());
+        } catch (const cl::Error&) {
+            return false;
+        }
+        return true;
+    }
+
+    void storeBinary(const cl::Program& program, const std::string& path) {
+        cl::Program::Binaries binaries = program.getInfo<CL_PROGRAM_BINARIES>();
+        if (binaries.empty() || binaries[0].empty()) {
+            return;
+        }
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        // 先写临时文件再改名, 并发启动的进程不会读到写了一半的二进制
+        std::string temporary = temporary_path(path);
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) {
+                return;
+            }
+            out.write(reinterpret_cast<const char*>(binaries[0].data()), binaries[0].size());
+            out.close();
+            if (!out) {
+                // 磁盘满等写入失败时不留下残缺的临时文件
+                std::filesystem::remove(temporary, error);
+                return;
+            }
+        }
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            std::filesystem::remove(temporary, error);
+        }
+    }
+};
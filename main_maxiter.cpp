@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "main_openmp.cpp"
+
+// 迭代上限随缩放深度增长: 视口高度每缩小一半增加 64 次, 再向上取到 2 的幂,
+// 这样得到的上限总是 with_max_iter 中编译期实例化的值之一.
+inline int round_max_iter(int max_iter, int min_iter = 256, int max_limit = 8192) {
+    int limit = min_iter;
+    while (limit < max_iter && limit < max_limit) {
+        limit *= 2;
+    }
+    return limit;
+}
+
+inline int adaptive_max_iter(double scale, int min_iter = 256, int max_limit = 8192) {
+    double depth = std::max(0.0, std::log2(1.0 / scale));
+    return round_max_iter(static_cast<int>(min_iter + 64 * depth), min_iter, max_limit);
+}
+
+// 根据上一帧的迭代次数直方图调整上限: 逃逸点集中在上限附近时说明上限太低, 细节被当成集合内部;
+// 所有逃逸点都远低于上限时说明上限浪费. 结果不低于按缩放深度得到的值.
+class MaxIterController {
+public:
+    explicit MaxIterController(int min_iter = 256, int max_limit = 8192)
+        : min_iter(min_iter), max_limit(max_limit), max_iter(min_iter) {}
+
+    int current() const { return max_iter; }
+
+    int update(const uint16_t* iters, int count, double scale) {
+        int floor_iter = adaptive_max_iter(scale, min_iter, max_limit);
+        int near_limit = 0;
+        int highest = 0;
+        int threshold = max_iter - max_iter / 8;
+        for (int i = 0; i < count; ++i) {
+            int iter = iters[i];
+            if (iter < max_iter) {
+                highest = std::max(highest, iter);
+                near_limit += (iter >= threshold);
+            }
+        }
+
+        if (near_limit > count / 1000 && max_iter < max_limit) {
+            max_iter *= 2;
+        } else if (highest < max_iter / 4 && max_iter > floor_iter) {
+            max_iter /= 2;
+        }
+        max_iter = std::max(max_iter, floor_iter);
+        return max_iter;
+    }
+
+private:
+    int min_iter;
+    int max_limit;
+    int max_iter;
+};
@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "main_opencl.cpp"
+
+// 多设备分带渲染: 每帧按行切成与设备数相同的条带, 各设备在自己的线程中同时计算.
+// 条带高度按上一帧测得的吞吐量 (行/秒) 重新分配, 吞吐量做指数平滑, 避免因为条带内容变化而来回振荡.
+class MultiDeviceOpenCL {
+public:
+    MultiDeviceOpenCL(int width, int height, const DeviceSelection& selection = DeviceSelection(), double smoothing = 0.5)
+        : height(height), smoothing(smoothing) {
+        std::vector<cl::Device> devices = select_devices(selection);
+        // 设备比行数多时多出的设备分不到条带
+        if (static_cast<int>(devices.size()) > height) {
+            devices.resize(height);
+        }
+        for (const cl::Device& device : devices) {
+            engines.emplace_back(new MandelbrotOpenCL(width, height, device));
+        }
+
+        int count = deviceCount();
+        rows.assign(count, 0);
+        seconds.assign(count, 0.0);
+        speed.assign(count, 0.0);
+        for (int i = 0; i < count; ++i) {
+            rows[i] = height / count + (i < height % count ? 1 : 0);
+        }
+    }
+
+    int deviceCount() const { return static_cast<int>(engines.size()); }
+    std::string deviceName(int i) const { return engines[i]->deviceName(); }
+    const std::vector<int>& bands() const { return rows; }           // 下一帧各设备的行数
+    const std::vector<double>& lastTimes() const { return seconds; } // 上一帧各设备的耗时 (秒)
+
+    template<typename T>
+    void compute(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+        int count = deviceCount();
+        std::vector<int> first(count, 0);
+        for (int i = 1; i < count; ++i) {
+            first[i] = first[i - 1] + rows[i - 1];
+        }
+
+        auto work = [&](int i) {
+            auto start = std::chrono::high_resolution_clock::now();
+            engines[i]->computeRows(output, first[i], rows[i], x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+            seconds[i] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        };
+
+        // 第 0 个设备在调用线程上提交, 其余设备各用一个线程
+        std::vector<std::thread> threads;
+        for (int i = 1; i < count; ++i) {
+            threads.emplace_back(work, i);
+        }
+        work(0);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        rebalance();
+    }
+
+private:
+    int height;
+    double smoothing;
+    std::vector<std::unique_ptr<MandelbrotOpenCL>> engines;
+    std::vector<int> rows;
+    std::vector<double> seconds;
+    std::vector<double> speed;
+
+    void rebalance() {
+        int count = deviceCount();
+        if (count < 2) {
+            return;
+        }
+        double total = 0.0;
+        for (int i = 0; i < count; ++i) {
+            double measured = rows[i] / std::max(seconds[i], 1e-6);
+            speed[i] = speed[i] > 0.0 ? smoothing * speed[i] + (1.0 - smoothing) * measured : measured;
+            total += speed[i];
+        }
+
+        // 每个设备至少一行, 这样慢设备的吞吐量仍然能被测量; 取整剩下的行给小数部分最大的设备
+        int remaining = height - count;
+        std::vector<double> share(count);
+        int assigned = 0;
+        for (int i = 0; i < count; ++i) {
+            share[i] = remaining * speed[i] / total;
+            rows[i] = 1 + static_cast<int>(share[i]);
+            assigned += rows[i];
+        }
+        while (assigned < height) {
+            int best = 0;
+            for (int i = 1; i < count; ++i) {
+                if (share[i] - static_cast<int>(share[i]) > share[best] - static_cast<int>(share[best])) {
+                    best = i;
+                }
+            }
+            ++rows[best];
+            share[best] = static_cast<int>(share[best]);
+            ++assigned;
+        }
+    }
+};
@@ -1,3 +1,4 @@
+#pragma once
 #define CL_HPP_TARGET_OPENCL_VERSION 300
 #define CL_HPP_ENABLE_EXCEPTIONS
 #include <CL/opencl.hpp>
@@ -6,12 +7,142 @@
 #include <vector>
 #include <exception>
 #include <thread>
+#include <map>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <cstring>
+#include <climits>
+#include "main_perturbation.cpp"
+#include "main_antialias.cpp"
+#include "main_kernelcache.cpp"
+#include "main_doubledouble.cpp"
+#include "main_trace.cpp"
+#include "main_outputview.cpp"
+#include "main_formula.cpp"
 
+// 设备选择: 在所有平台上按类型筛选, name 非空时再按设备名子串匹配, index >= 0 时只保留第 index 个匹配.
+// sub_devices > 1 时把每个选中的设备按计算单元均分成这么多个子设备 (例如 PoCL 的 CPU 设备)
+struct DeviceSelection {
+    cl_device_type type = CL_DEVICE_TYPE_GPU;
+    std::string name;
+    int index = -1;
+    int sub_devices = 0;
+    bool fallback = true;   // 没有匹配的设备时退回到任意设备
+};
+
+inline cl_device_type parse_device_type(const std::string& text) {
+    if (text == "gpu") return CL_DEVICE_TYPE_GPU;
+    if (text == "cpu") return CL_DEVICE_TYPE_CPU;
+    if (text == "accelerator") return CL_DEVICE_TYPE_ACCELERATOR;
+    if (text == "all") return CL_DEVICE_TYPE_ALL;
+    std::cerr << "Unknown device type: " << text << std::endl;
+    exit(1);
+}
+
+inline std::vector<cl::Device> select_devices(const DeviceSelection& selection) {
+    std::vector<cl::Platform> platforms;
+    cl::Platform::get(&platforms);
+    if (platforms.empty()) {
+        std::cerr << "No OpenCL platforms found." << std::endl;
+        exit(1);
+    }
+
+    auto matching = [&platforms, &selection](cl_device_type type) {
+        std::vector<cl::Device> result;
+        for (auto& platform : platforms) {
+            std::vector<cl::Device> devices;
+            // 个别实现对平台上不存在的设备类型报错而不是返回空列表, 跳过这个平台
+            try {
+                platform.getDevices(type, &devices);
+            } catch (const cl::Error&) {
+                continue;
+            }
+            for (auto& device : devices) {
+                if (selection.name.empty() || device.getInfo<CL_DEVICE_NAME>().find(selection.name) != std::string::npos) {
+                    result.push_back(device);
+                }
+            }
+        }
+        return result;
+    };
+
+    std::vector<cl::Device> devices = matching(selection.type);
+    if (devices.empty() && selection.fallback) {
+        // 没有 GPU 时退回到任意设备, 例如 PoCL 这类 CPU 实现
+        devices = matching(CL_DEVICE_TYPE_ALL);
+    }
+    if (selection.index >= 0) {
+        if (selection.index >= static_cast<int>(devices.size())) {
+            std::cerr << "OpenCL device index " << selection.index << " out of range (" << devices.size() << " devices)" << std::endl;
+            exit(1);
+        }
+        devices = {devices[selection.index]};
+    }
+    if (devices.empty()) {
+        std::cerr << "No OpenCL devices found." << std::endl;
+        exit(1);
+    }
+
+    if (selection.sub_devices <= 1) {
+        return devices;
+    }
+    std::vector<cl::Device> result;
+    for (auto& device : devices) {
+        cl_uint units = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        cl_uint parts = static_cast<cl_uint>(selection.sub_devices);
+        std::vector<cl::Device> subs;
+        if (units >= parts && device.getInfo<CL_DEVICE_PARTITION_MAX_SUB_DEVICES>() >= parts) {
+            const cl_device_partition_property properties[] = {CL_DEVICE_PARTITION_EQUALLY, static_cast<cl_device_partition_property>(units / parts), 0};
+            try {
+                device.createSubDevices(properties, &subs);
+            } catch (const cl::Error&) {
+                subs.clear();
+            }
+        }
+        if (subs.empty()) {
+            std::cerr << "Device " << device.getInfo<CL_DEVICE_NAME>() << " cannot be partitioned, using it whole" << std::endl;
+            result.push_back(device);
+        } else {
+            result.insert(result.end(), subs.begin(), subs.end());
+        }
+    }
+    return result;
+}
+
+// 不退出的探测: 没有 OpenCL 运行时, 没有平台或没有任何设备时返回 false
+inline bool opencl_available() {
+    std::vector<cl::Platform> platforms;
+    try {
+        cl::Platform::get(&platforms);
+    } catch (const cl::Error&) {
+        return false;
+    }
+    for (auto& platform : platforms) {
+        std::vector<cl::Device> devices;
+        try {
+            platform.getDevices(CL_DEVICE_TYPE_ALL, &devices);
+        } catch (const cl::Error&) {
+            continue;
+        }
+        if (!devices.empty()) {
+            return true;
+        }
+    }
+    return false;
+}
 
 class MandelbrotOpenCL {
 public:
-    MandelbrotOpenCL(int width, int height) : width(width), height(height) {
-        initOpenCL();
+    // cache_dir 为程序二进制缓存目录, 为空时每次启动都从源码编译
+    MandelbrotOpenCL(int width, int height, const std::string& cache_dir = "kernel_cache")
+        : width(width), height(height), kernelCache(cache_dir) {
+        initOpenCL(select_devices(DeviceSelection())[0]);
+    }
+
+    MandelbrotOpenCL(int width, int height, const cl::Device& target, const std::string& cache_dir = "kernel_cache")
+        : width(width), height(height), kernelCache(cache_dir) {
+        initOpenCL(target);
     }
 
     ~MandelbrotOpenCL() {
@@ -35,6 +166,35 @@ public:
         return result;
     }
 
+    const KernelCacheStats& cacheStats() const { return kernelCache.stats(); }
+
+    // 工作组形状, 0 表示由驱动选择 (cl::NullRange); 影响 compute, computeRows, computeBatch, computeAsync 和 computeFieldRows
+    void setWorkGroup(int x, int y) {
+        localX = x;
+        localY = y;
+    }
+
+    int workGroupX() const { return localX; }
+    int workGroupY() const { return localY; }
+
+    // 工作组大小上限: 设备上限与 compute 对这种坐标类型和迭代上限实际提交的内核的上限中较小的一个.
+    // 寄存器用量大的内核 (例如 double-double) 上限可能更小
+    template<typename T>
+    size_t maxWorkGroupSize(int max_iter = 256) {
+        cl::Kernel kernel;
+        if constexpr (std::is_same<T, dd_real>::value) {
+            kernel = is_specialised_max_iter(max_iter) ? variantKernels(false, max_iter).dd : ddKernel;
+        } else {
+            bool single = std::is_same<T, float>::value;
+            kernel = single || is_specialised_max_iter(max_iter) ? variantKernels(single, max_iter).mandelbrot : kernels[0];
+        }
+        size_t limit = device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>();
+        return std::min(limit, kernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(device));
+    }
+
+    std::string deviceName() const { return device.getInfo<CL_DEVICE_NAME>(); }
+    std::string driverVersion() const { return device.getInfo<CL_DRIVER_VERSION>(); }
+
     void printBuildLog(const cl::Program& program, const cl::Device& device) {
         size_t log_size;
         clGetProgramBuildInfo(program(), device(), CL_PROGRAM_BUILD_LOG, 0, nullptr, &log_size);
@@ -44,8 +204,86 @@ public:
     }
 
     template<typename T>
-    void compute(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y) {
-        cl::Kernel kernel = kernels[std::is_same<T, double>::value ? 0 : 1];
+    void compute(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, ShortcutStats* shortcuts = nullptr,
+                 int max_iter = 256) {
+        if (shortcuts) {
+            computeShortcut(output, x_start, x_finish, y_start, y_finish, *shortcuts, max_iter);
+            return;
+        }
+
+        cl::Kernel kernel = prepareKernel(buffers[0], x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+        enqueueAndRead(kernel, 0, height, [&](cl::Event* event) {
+            queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, 0, width * height * 3 * sizeof(uint8_t), output, nullptr, event);
+        });
+    }
+
+    // 写入输出视图: 内核按视图的像素格式和方向写设备缓冲区, 再按视图的行距整块读到最终位置,
+    // 行距与紧密排列相同时退化为普通读回. 只支持 float / double 坐标
+    template<typename T>
+    void compute(const OutputView& output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+        bool single = std::is_same<T, float>::value;
+        bool specialised = single || is_specialised_max_iter(max_iter);
+        cl::Kernel kernel = specialised ? variantKernels(single, max_iter).view : viewKernel;
+        kernel.setArg(0, viewBuffer);
+        kernel.setArg(1, width);
+        kernel.setArg(2, height);
+        kernel.setArg(3, x_start);
+        kernel.setArg(4, x_finish);
+        kernel.setArg(5, y_start);
+        kernel.setArg(6, y_finish);
+        kernel.setArg(7, max_iter);
+        kernel.setArg(8, static_cast<int>(output.format));
+        kernel.setArg(9, output.orientation() == TOP_DOWN ? 1 : 0);
+
+        size_t packed = static_cast<size_t>(width) * pixel_size(output.format);
+        uint8_t* target = output.base(height);
+        enqueueAndRead(kernel, 0, height, [&](cl::Event* event) {
+            if (output.rowBytes() == packed) {
+                queues[0].enqueueReadBuffer(viewBuffer, CL_TRUE, 0, packed * height, target, nullptr, event);
+            } else {
+                std::array<size_t, 3> origin = {0, 0, 0};
+                std::array<size_t, 3> region = {packed, static_cast<size_t>(height), 1};
+                queues[0].enqueueReadBufferRect(viewBuffer, CL_TRUE, origin, origin, region, packed, 0, output.rowBytes(), 0, target, nullptr, event);
+            }
+        });
+    }
+
+    // double-double 版本: 像素间距在主机端以 double-double 算好, 设备上只做加法和乘法.
+    // 内部快捷路径没有 double-double 内核, shortcuts 被忽略
+    void compute(uint8_t* output, dd_real x_start, dd_real x_finish, dd_real y_start, dd_real y_finish, dd_real center_x, dd_real center_y,
+                 ShortcutStats* shortcuts = nullptr, int max_iter = 256) {
+        dd_real dx = (x_finish - x_start) / width;
+        dd_real dy = (y_finish - y_start) / height;
+        cl::Kernel kernel = is_specialised_max_iter(max_iter) ? variantKernels(false, max_iter).dd : ddKernel;
+        kernel.setArg(0, buffers[0]);
+        kernel.setArg(1, width);
+        kernel.setArg(2, height);
+        kernel.setArg(3, to_cl_double2(x_start));
+        kernel.setArg(4, to_cl_double2(dx));
+        kernel.setArg(5, to_cl_double2(y_start));
+        kernel.setArg(6, to_cl_double2(dy));
+        kernel.setArg(7, max_iter);
+        enqueueAndRead(kernel, 0, height, [&](cl::Event* event) {
+            queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, 0, width * height * 3 * sizeof(uint8_t), output, nullptr, event);
+        });
+    }
+
+    // 其他逃逸时间公式: 公式和 Multibrot 幂次以 -DFORMULA / -DPOWER 编译进程序变体, 每种公式第一次使用时构建一次.
+    // 与 fractal_omp 的输出相同, 只支持 float / double 坐标
+    template<typename T>
+    void computeFractal(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, const FractalSpec& spec,
+                        int max_iter = 256) {
+        std::string formula;
+        if (spec.kind == FRACTAL_MULTIBROT && spec.power != 2) {
+            if (spec.power < 2 || spec.power > MULTIBROT_MAX_POWER) {
+                std::cerr << "Multibrot power must be between 2 and " << MULTIBROT_MAX_POWER << ", got " << spec.power << std::endl;
+                exit(1);
+            }
+            formula = " -DFORMULA=2 -DPOWER=" + std::to_string(spec.power);
+        } else if (spec.kind == FRACTAL_JULIA || spec.kind == FRACTAL_BURNING_SHIP) {
+            formula = " -DFORMULA=" + std::to_string(static_cast<int>(spec.kind));
+        }
+        cl::Kernel kernel = variantKernels(std::is_same<T, float>::value, max_iter, formula).fractal;
         kernel.setArg(0, buffers[0]);
         kernel.setArg(1, width);
         kernel.setArg(2, height);
@@ -53,56 +291,505 @@ public:
         kernel.setArg(4, x_finish);
         kernel.setArg(5, y_start);
         kernel.setArg(6, y_finish);
-        kernel.setArg(7, center_x);
-        kernel.setArg(8, center_y);
+        kernel.setArg(7, static_cast<T>(spec.julia_real));
+        kernel.setArg(8, static_cast<T>(spec.julia_imag));
+        kernel.setArg(9, max_iter);
+        enqueueAndRead(kernel, 0, height, [&](cl::Event* event) {
+            queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, 0, width * height * 3 * sizeof(uint8_t), output, nullptr, event);
+        });
+    }
+
+    // 批量渲染与本对象同样大小的多张图像: 每批只有一次视口表写入, 一次内核提交和一次读回, 读回后再分发到各自的输出.
+    // 图像数超过设备单个缓冲区的容量时分成几批. 与逐张调用 compute 的输出相同, 只支持 float / double 坐标
+    template<typename T>
+    void computeBatch(const std::vector<BatchViewport<T>>& views, int max_iter = 256) {
+        if (views.empty()) {
+            return;
+        }
+        bool single = std::is_same<T, float>::value;
+        bool specialised = single || is_specialised_max_iter(max_iter);
+        cl::Kernel kernel = specialised ? variantKernels(single, max_iter).batch : batchKernel;
+        size_t image_bytes = static_cast<size_t>(width) * height * 3;
+        size_t capacity = reserveBatch(views.size());
+
+        std::vector<T> table;
+        for (size_t first = 0; first < views.size(); first += capacity) {
+            int count = static_cast<int>(std::min(capacity, views.size() - first));
+            table.clear();
+            for (int i = 0; i < count; ++i) {
+                const BatchViewport<T>& view = views[first + i];
+                table.insert(table.end(), {view.x_start, view.x_finish, view.y_start, view.y_finish});
+            }
+            // 队列按顺序执行, 后面的阻塞读回返回时写入已经完成, table 可以复用
+            queues[0].enqueueWriteBuffer(batchViewBuffer, CL_FALSE, 0, table.size() * sizeof(T), table.data());
+            kernel.setArg(0, batchBuffer);
+            kernel.setArg(1, width);
+            kernel.setArg(2, height);
+            kernel.setArg(3, count);
+            kernel.setArg(4, batchViewBuffer);
+            kernel.setArg(5, max_iter);
+            enqueueAndRead(kernel, 0, height, [&](cl::Event* event) {
+                queues[0].enqueueReadBuffer(batchBuffer, CL_TRUE, 0, image_bytes * count, batchStaging.data(), nullptr, event);
+            }, count);
+            for (int i = 0; i < count; ++i) {
+                std::memcpy(views[first + i].output, batchStaging.data() + i * image_bytes, image_bytes);
+            }
+        }
+    }
+
+    // 只计算 [first_row, first_row + rows) 这些行, 结果写入 output 中对应的位置, 其余行不变.
+    // 内核的全局偏移让 get_global_id(1) 仍然是整帧中的行号
+    template<typename T>
+    void computeRows(uint8_t* output, int first_row, int rows, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y,
+                     int max_iter = 256) {
+        if (rows <= 0) {
+            return;
+        }
+        cl::Kernel kernel = prepareKernel(buffers[0], x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+        size_t offset = static_cast<size_t>(first_row) * width * 3;
+        enqueueAndRead(kernel, first_row, rows, [&](cl::Event* event) {
+            queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, offset, static_cast<size_t>(rows) * width * 3, output + offset, nullptr, event);
+        });
+    }
+
+    // 异步帧: ready 在结果映射到主机内存后触发, 之后 pixels 指向可直接读取的结果
+    struct AsyncFrame {
+        int slot = -1;
+        cl::Event ready;
+        const uint8_t* pixels = nullptr;
+    };
+
+    // 分配 depth 个 CL_MEM_ALLOC_HOST_PTR 缓冲区, 多帧可以同时在设备上排队,
+    // 结果通过 map 直接交给调用方, 省去一次拷贝到可分页内存
+    void initAsync(int depth = 2) {
+        asyncSlots.clear();
+        asyncSlots.resize(depth);
+        for (AsyncSlot& slot : asyncSlots) {
+            slot.buffer = cl::Buffer(contexts[0], CL_MEM_WRITE_ONLY | CL_MEM_ALLOC_HOST_PTR, width * height * 3 * sizeof(uint8_t));
+        }
+        nextSlot = 0;
+    }
+
+    // 非阻塞地提交一帧; 调用方可以在这一帧计算时处理上一帧, 处理完后调用 releaseFrame
+    template<typename T>
+    AsyncFrame computeAsync(T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+        if (asyncSlots.empty()) {
+            initAsync();
+        }
+
+        AsyncFrame frame;
+        frame.slot = nextSlot;
+        nextSlot = (nextSlot + 1) % static_cast<int>(asyncSlots.size());
+
+        // 调用方还没有归还这个缓冲区时, 等它的结果就绪后直接回收
+        AsyncSlot& slot = asyncSlots[frame.slot];
+        if (slot.mapped) {
+            slot.ready.wait();
+            queues[0].enqueueUnmapMemObject(slot.buffer, slot.mapped);
+            slot.mapped = nullptr;
+        }
+
+        cl::Kernel kernel = prepareKernel(slot.buffer, x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+        enqueueRows(kernel, 0, height);
+        slot.mapped = queues[0].enqueueMapBuffer(slot.buffer, CL_FALSE, CL_MAP_READ, 0, width * height * 3 * sizeof(uint8_t), nullptr, &slot.ready);
+        queues[0].flush();
+
+        frame.ready = slot.ready;
+        frame.pixels = static_cast<const uint8_t*>(slot.mapped);
+        return frame;
+    }
+
+    const uint8_t* waitFrame(const AsyncFrame& frame) {
+        frame.ready.wait();
+        return frame.pixels;
+    }
+
+    void releaseFrame(const AsyncFrame& frame) {
+        AsyncSlot& slot = asyncSlots[frame.slot];
+        if (slot.mapped) {
+            queues[0].enqueueUnmapMemObject(slot.buffer, slot.mapped);
+            slot.mapped = nullptr;
+        }
+    }
+
+    // 内部快捷路径版本, 计数器在设备端用原子操作累加. float 坐标使用 -DREAL=float 变体, 与 CPU 端 float 快捷路径的结果相同
+    template<typename T>
+    void computeShortcut(uint8_t* output, T x_start, T x_finish, T y_start, T y_finish, ShortcutStats& shortcuts, int max_iter = 256) {
+        int counters[3] = {0, 0, 0};
+        queues[0].enqueueWriteBuffer(counterBuffer, CL_FALSE, 0, sizeof(counters), counters);
+
+        bool single = std::is_same<T, float>::value;
+        bool specialised = single || is_specialised_max_iter(max_iter);
+        cl::Kernel kernel = specialised ? variantKernels(single, max_iter).shortcut : shortcutKernel;
+        kernel.setArg(0, buffers[0]);
+        kernel.setArg(1, counterBuffer);
+        kernel.setArg(2, width);
+        kernel.setArg(3, height);
+        kernel.setArg(4, x_start);
+        kernel.setArg(5, x_finish);
+        kernel.setArg(6, y_start);
+        kernel.setArg(7, y_finish);
+        kernel.setArg(8, max_iter);
 
         queues[0].enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
+        queues[0].enqueueReadBuffer(buffers[0], CL_FALSE, 0, width * height * 3 * sizeof(uint8_t), output);
+        queues[0].enqueueReadBuffer(counterBuffer, CL_TRUE, 0, sizeof(counters), counters);
+
+        shortcuts.cardioid += counters[0];
+        shortcuts.bulb += counters[1];
+        shortcuts.periodic += counters[2];
+    }
+
+    // 迭代场版本: 只传回每像素 2 字节的迭代次数, 由主机端 colorize 着色
+    void computeField(uint16_t* iters, double x_start, double x_finish, double y_start, double y_finish, int max_iter = 256) {
+        computeFieldRows(iters, 0, height, x_start, x_finish, y_start, y_finish, max_iter);
+    }
+
+    // 只计算 [first_row, first_row + rows) 的迭代场, 与 computeRows 一样使用全局偏移
+    void computeFieldRows(uint16_t* iters, int first_row, int rows, double x_start, double x_finish, double y_start, double y_finish,
+                          int max_iter = 256) {
+        if (rows <= 0) {
+            return;
+        }
+        cl::Kernel kernel = is_specialised_max_iter(max_iter) ? variantKernels(false, max_iter).field : fieldKernel;
+        kernel.setArg(0, fieldBuffer);
+        kernel.setArg(1, width);
+        kernel.setArg(2, height);
+        kernel.setArg(3, x_start);
+        kernel.setArg(4, x_finish);
+        kernel.setArg(5, y_start);
+        kernel.setArg(6, y_finish);
+        kernel.setArg(7, max_iter);
+
+        enqueueRows(kernel, first_row, rows);
+        size_t offset = static_cast<size_t>(first_row) * width;
+        queues[0].enqueueReadBuffer(fieldBuffer, CL_TRUE, offset * sizeof(uint16_t), static_cast<size_t>(rows) * width * sizeof(uint16_t), iters + offset);
+    }
+
+    // 自适应抗锯齿: 先在设备上算迭代场, 第二个内核只对边界像素做抖动超采样
+    void computeAntialias(uint8_t* output, double x_start, double x_finish, double y_start, double y_finish,
+                          int samples = 8, int threshold = 2, AntialiasStats* stats = nullptr, int max_iter = 256) {
+        cl::Kernel field = is_specialised_max_iter(max_iter) ? variantKernels(false, max_iter).field : fieldKernel;
+        field.setArg(0, fieldBuffer);
+        field.setArg(1, width);
+        field.setArg(2, height);
+        field.setArg(3, x_start);
+        field.setArg(4, x_finish);
+        field.setArg(5, y_start);
+        field.setArg(6, y_finish);
+        field.setArg(7, max_iter);
+
+        int counter = 0;
+        queues[0].enqueueWriteBuffer(counterBuffer, CL_FALSE, 0, sizeof(counter), &counter);
+        antialiasKernel.setArg(0, buffers[0]);
+        antialiasKernel.setArg(1, fieldBuffer);
+        antialiasKernel.setArg(2, counterBuffer);
+        antialiasKernel.setArg(3, width);
+        antialiasKernel.setArg(4, height);
+        antialiasKernel.setArg(5, x_start);
+        antialiasKernel.setArg(6, x_finish);
+        antialiasKernel.setArg(7, y_start);
+        antialiasKernel.setArg(8, y_finish);
+        antialiasKernel.setArg(9, samples);
+        antialiasKernel.setArg(10, threshold);
+        antialiasKernel.setArg(11, max_iter);
+
+        queues[0].enqueueNDRangeKernel(field, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
+        queues[0].enqueueNDRangeKernel(antialiasKernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
+        queues[0].enqueueReadBuffer(buffers[0], CL_FALSE, 0, width * height * 3 * sizeof(uint8_t), output);
+        queues[0].enqueueReadBuffer(counterBuffer, CL_TRUE, 0, sizeof(counter), &counter);
+
+        if (stats) {
+            stats->supersampled = counter;
+            stats->fraction = static_cast<double>(counter) / (static_cast<double>(width) * height);
+        }
+    }
+
+    // 深度缩放: 参考轨道在主机上以高精度计算, 每个像素的差值迭代在设备上完成
+    void computePerturbation(uint8_t* output, const dd_real& center_x, const dd_real& center_y, double scale, double ratio,
+                             const PerturbationOptions& options = PerturbationOptions(), PerturbationStats* stats = nullptr, int max_iter = 256) {
+        // 参考轨道最多 max_iter + 1 个点, 缓冲区按需要增长
+        size_t orbit_bytes = static_cast<size_t>(max_iter + 1) * 2 * sizeof(double);
+        if (orbit_bytes > orbitBytes) {
+            orbitBuffer = cl::Buffer(contexts[0], CL_MEM_READ_ONLY, orbit_bytes);
+            orbitBytes = orbit_bytes;
+        }
+        int limbs = perturbation_limbs(scale, width, height);
+        double dx = ratio * scale / width;
+        double dy = scale / height;
+        double half_w = 0.5 * ratio * scale;
+        double half_h = 0.5 * scale;
+
+        BigFixed c_re = bigfixed_from(center_x, limbs), c_im = bigfixed_from(center_y, limbs);
+        double offset_re = 0.0, offset_im = 0.0;
+        std::vector<uint8_t> glitch(width * height);
+        std::vector<double> interleaved;
+        long long glitched = 0;
+        int references = 0;
+
+        for (int pass = 0; ; ++pass) {
+            ReferenceOrbit<double> orbit = compute_reference_orbit<double>(c_re, c_im, max_iter);
+            ++references;
+            interleaved.resize(orbit.re.size() * 2);
+            for (size_t i = 0; i < orbit.re.size(); ++i) {
+                interleaved[2 * i] = orbit.re[i];
+                interleaved[2 * i + 1] = orbit.im[i];
+            }
+            queues[0].enqueueWriteBuffer(orbitBuffer, CL_FALSE, 0, interleaved.size() * sizeof(double), interleaved.data());
+
+            perturbKernel.setArg(0, buffers[0]);
+            perturbKernel.setArg(1, glitchBuffer);
+            perturbKernel.setArg(2, orbitBuffer);
+            perturbKernel.setArg(3, orbit.last());
+            perturbKernel.setArg(4, width);
+            perturbKernel.setArg(5, height);
+            perturbKernel.setArg(6, dx);
+            perturbKernel.setArg(7, dy);
+            perturbKernel.setArg(8, half_w);
+            perturbKernel.setArg(9, half_h);
+            perturbKernel.setArg(10, offset_re);
+            perturbKernel.setArg(11, offset_im);
+            perturbKernel.setArg(12, options.rebase ? 1 : 0);
+            perturbKernel.setArg(13, options.glitch_tolerance);
+            perturbKernel.setArg(14, pass);
+            perturbKernel.setArg(15, max_iter);
+
+            queues[0].enqueueNDRangeKernel(perturbKernel, cl::NullRange, cl::NDRange(width, height), cl::NullRange);
+            queues[0].enqueueReadBuffer(glitchBuffer, CL_TRUE, 0, width * height * sizeof(uint8_t), glitch.data());
+
+            std::vector<int> pending;
+            for (int i = 0; i < width * height; ++i) {
+                if (glitch[i]) {
+                    pending.push_back(i);
+                }
+            }
+            glitched = static_cast<long long>(pending.size());
+            if (pending.empty() || references >= options.max_references) {
+                break;
+            }
+
+            // 次级参考点取自 glitch 像素, 与 CPU 版本的选择方式相同
+            int idx = pending[pending.size() / 2];
+            offset_re = (idx % width) * dx - half_w;
+            offset_im = (idx / width) * dy - half_h;
+            c_re = bigfixed_from(center_x, limbs) + BigFixed(offset_re, limbs);
+            c_im = bigfixed_from(center_y, limbs) + BigFixed(offset_im, limbs);
+        }
+
         queues[0].enqueueReadBuffer(buffers[0], CL_TRUE, 0, width * height * 3 * sizeof(uint8_t), output);
+
+        if (stats) {
+            stats->references = references;
+            stats->glitched = glitched;
+        }
     }
 
 private:
+    struct AsyncSlot {
+        cl::Buffer buffer;
+        cl::Event ready;
+        void* mapped = nullptr;
+    };
+
     int width, height;
     std::vector<cl::Context> contexts;
     std::vector<cl::Program> programs;
     std::vector<cl::Kernel> kernels;
     std::vector<cl::CommandQueue> queues;
     std::vector<cl::Buffer> buffers;
+    cl::Kernel perturbKernel;
+    cl::Kernel shortcutKernel;
+    cl::Kernel fieldKernel;
+    cl::Kernel antialiasKernel;
+    cl::Kernel ddKernel;
+    cl::Kernel viewKernel;
+    cl::Kernel batchKernel;
+    cl::Buffer counterBuffer;
+    cl::Buffer glitchBuffer;
+    cl::Buffer orbitBuffer;
+    size_t orbitBytes = 0;
+    cl::Buffer fieldBuffer;   // mandelbrot_supersample 还要读取, 必须可读写
+    cl::Buffer viewBuffer;   // 按最大的像素格式 (4 字节) 分配
+    // 批量渲染的输出, 视口表和主机端中转缓冲区, 第一次使用时按批量大小分配
+    cl::Buffer batchBuffer;
+    cl::Buffer batchViewBuffer;
+    std::vector<uint8_t> batchStaging;
+    size_t batchCapacity = 0;
+    std::vector<AsyncSlot> asyncSlots;
+    int nextSlot = 0;
 
-    void initOpenCL() {
-        std::vector<cl::Platform> platforms;
-        cl::Platform::get(&platforms);
-        if (platforms.empty()) {
-            std::cerr << "No OpenCL platforms found." << std::endl;
-            exit(1);
+    // 特化变体: 图像尺寸总是编译成常量, 单精度用 -DREAL=float, 常用迭代上限用 -DMAX_ITER=N, fractal 内核的公式用 -DFORMULA=K.
+    // 每个变体第一次使用时经过程序二进制缓存构建一次
+    struct VariantKernels {
+        cl::Program program;
+        cl::Kernel mandelbrot;
+        cl::Kernel field;
+        cl::Kernel dd;
+        cl::Kernel view;
+        cl::Kernel fractal;
+        cl::Kernel batch;
+        cl::Kernel shortcut;
+    };
+    cl::Device device;
+    bool profiling = false;
+    int localX = 0, localY = 0;
+    // 插桩轨道: 两条命令的排队等待时间会互相重叠, 各占一条; 设备上的执行是串行的, 共用一条
+    Tracer::Track* kernelQueueLane = nullptr;
+    Tracer::Track* readQueueLane = nullptr;
+    Tracer::Track* executeLane = nullptr;
+    std::string kernelSource;
+    KernelCache kernelCache;
+    std::map<std::string, VariantKernels> variantPrograms;
+
+    static cl_double2 to_cl_double2(const dd_real& value) {
+        cl_double2 result;
+        result.s[0] = value.hi;
+        result.s[1] = value.lo;
+        return result;
+    }
+
+    std::string sizeOptions() const {
+        return "-DIMAGE_WIDTH=" + std::to_string(width) + " -DIMAGE_HEIGHT=" + std::to_string(height);
+    }
+
+    // max_iter 不是 with_max_iter 中的值时使用运行时上限; formula 为附加的公式选项, 为空时是 Mandelbrot 集
+    VariantKernels& variantKernels(bool single, int max_iter, const std::string& formula = "") {
+        std::string options = sizeOptions() + formula;
+        if (single) {
+            options += " -DREAL=float";
+        }
+        if (is_specialised_max_iter(max_iter)) {
+            options += " -DMAX_ITER=" + std::to_string(max_iter);
+        }
+        auto it = variantPrograms.find(options);
+        if (it != variantPrograms.end()) {
+            return it->second;
         }
+        VariantKernels entry;
+        entry.program = kernelCache.build(contexts[0], device, kernelSource, options);
+        entry.mandelbrot = cl::Kernel(entry.program, "mandelbrot");
+        entry.field = cl::Kernel(entry.program, "mandelbrot_field");
+        entry.dd = cl::Kernel(entry.program, "mandelbrot_dd");
+        entry.view = cl::Kernel(entry.program, "mandelbrot_view");
+        entry.fractal = cl::Kernel(entry.program, "fractal");
+        entry.batch = cl::Kernel(entry.program, "mandelbrot_batch");
+        entry.shortcut = cl::Kernel(entry.program, "mandelbrot_shortcut");
+        return variantPrograms.emplace(options, entry).first->second;
+    }
 
-        cl::Platform platform = platforms[0];
-        std::vector<cl::Device> devices;
-        platform.getDevices(CL_DEVICE_TYPE_GPU, &devices);
-        if (devices.empty()) {
-            std::cerr << "No OpenCL devices found." << std::endl;
-            exit(1);
+    // 批量缓冲区只增不减, 上限为设备单个缓冲区的大小; 返回每批最多的图像数
+    size_t reserveBatch(size_t count) {
+        size_t image_bytes = static_cast<size_t>(width) * height * 3;
+        // 内核中的输出下标是 int
+        size_t limit = std::min<size_t>(device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>(), INT_MAX) / image_bytes;
+        count = std::max<size_t>(1, std::min(count, limit));
+        if (count > batchCapacity) {
+            batchBuffer = cl::Buffer(contexts[0], CL_MEM_WRITE_ONLY, count * image_bytes);
+            batchViewBuffer = cl::Buffer(contexts[0], CL_MEM_READ_ONLY, count * 4 * sizeof(double));
+            batchStaging.resize(count * image_bytes);
+            batchCapacity = count;
         }
+        return batchCapacity;
+    }
 
-        cl::Device device = devices[0];
-        contexts.push_back(cl::Context(device));
-        queues.push_back(cl::CommandQueue(contexts[0], device));
+    // 提交覆盖 [first_row, first_row + rows) 的内核, layers > 1 时第三维是批量中的图像序号.
+    // 指定了工作组形状时全局范围向上取整到它的倍数, 多出的工作项由内核开头的边界检查丢弃
+    void enqueueRows(const cl::Kernel& kernel, int first_row, int rows, cl::Event* event = nullptr, int layers = 1) {
+        size_t global_x = width;
+        size_t global_y = rows;
+        cl::NDRange local = cl::NullRange;
+        if (localX > 0 && localY > 0) {
+            global_x = (width + localX - 1) / localX * localX;
+            global_y = (rows + localY - 1) / localY * localY;
+            local = layers > 1 ? cl::NDRange(localX, localY, 1) : cl::NDRange(localX, localY);
+        }
+        if (layers > 1) {
+            queues[0].enqueueNDRangeKernel(kernel, cl::NDRange(0, first_row, 0), cl::NDRange(global_x, global_y, layers), local, nullptr, event);
+        } else {
+            queues[0].enqueueNDRangeKernel(kernel, cl::NDRange(0, first_row), cl::NDRange(global_x, global_y), local, nullptr, event);
+        }
+    }
 
-        std::ifstream kernelFile("kernal.cl");
-        std::string src(std::istreambuf_iterator<char>(kernelFile), (std::istreambuf_iterator<char>()));
-        cl::Program::Sources sources;
-        sources.push_back({src.c_str(), src.length()});
-        programs.push_back(cl::Program(contexts[0], sources));
+    // 提交内核, 再由 read(event) 提交阻塞的读回; 插桩打开时记录两条命令的事件时间, 否则 event 为空
+    template<typename Read>
+    void enqueueAndRead(const cl::Kernel& kernel, int first_row, int rows, Read read, int layers = 1) {
+        if (!profiling) {
+            enqueueRows(kernel, first_row, rows, nullptr, layers);
+            read(nullptr);
+            return;
+        }
+        cl::Event kernelEvent, readEvent;
+        double submitted = Tracer::instance().now();
+        enqueueRows(kernel, first_row, rows, &kernelEvent, layers);
+        read(&readEvent);
+        // 设备时钟与主机时钟没有共同零点, 以内核的 QUEUED 时刻对齐到主机上的提交时刻
+        cl_ulong base = kernelEvent.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+        traceCommand(kernelEvent, "kernel", kernelQueueLane, submitted, base);
+        traceCommand(readEvent, "read", readQueueLane, submitted, base);
+    }
 
-        if (programs[0].build({device}) != CL_SUCCESS) {
-            std::cerr << "Error building: " << programs[0].getBuildInfo<CL_PROGRAM_BUILD_LOG>(device) << std::endl;
-            exit(1);
+    void traceCommand(const cl::Event& event, const char* name, Tracer::Track* queueLane, double submitted, cl_ulong base) {
+        auto micros = [&](cl_ulong ns) { return submitted + (static_cast<double>(ns) - static_cast<double>(base)) / 1000.0; };
+        double queued = micros(event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>());
+        double submit = micros(event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>());
+        double start = micros(event.getProfilingInfo<CL_PROFILING_COMMAND_START>());
+        double end = micros(event.getProfilingInfo<CL_PROFILING_COMMAND_END>());
+        Tracer& tracer = Tracer::instance();
+        tracer.record(queueLane, name, "opencl queued", queued, submit - queued);
+        tracer.record(queueLane, name, "opencl submitted", submit, start - submit);
+        tracer.record(executeLane, name, "opencl", start, end - start);
+    }
+
+    template<typename T>
+    cl::Kernel prepareKernel(const cl::Buffer& target, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+        bool single = std::is_same<T, float>::value;
+        bool specialised = single || is_specialised_max_iter(max_iter);
+        cl::Kernel kernel = specialised ? variantKernels(single, max_iter).mandelbrot : kernels[0];
+        kernel.setArg(0, target);
+        kernel.setArg(1, width);
+        kernel.setArg(2, height);
+        kernel.setArg(3, x_start);
+        kernel.setArg(4, x_finish);
+        kernel.setArg(5, y_start);
+        kernel.setArg(6, y_finish);
+        kernel.setArg(7, center_x);
+        kernel.setArg(8, center_y);
+        kernel.setArg(9, max_iter);
+        return kernel;
+    }
+
+    void initOpenCL(const cl::Device& target) {
+        device = target;
+        contexts.push_back(cl::Context(device));
+        // profiling 会给每条命令增加少量开销, 只在插桩打开时启用
+        profiling = Tracer::enabled();
+        queues.push_back(cl::CommandQueue(contexts[0], device, profiling ? CL_QUEUE_PROFILING_ENABLE : 0));
+        if (profiling) {
+            kernelQueueLane = Tracer::instance().lane(deviceName() + " kernel queue");
+            readQueueLane = Tracer::instance().lane(deviceName() + " read queue");
+            executeLane = Tracer::instance().lane(deviceName() + " execute");
         }
 
+        // 源码只用于计算缓存键; 二进制命中时不会再编译
+        kernelSource = loadKernel("kernal.cl");
+        programs.push_back(kernelCache.build(contexts[0], device, kernelSource, sizeOptions()));
+
         kernels.push_back(cl::Kernel(programs[0], "mandelbrot"));
-        kernels.push_back(cl::Kernel(programs[0], "mandelbrot_double"));
-        kernels.push_back(cl::Kernel(programs[0], "mandelbrot_float"));
         buffers.push_back(cl::Buffer(contexts[0], CL_MEM_WRITE_ONLY, width * height * 3 * sizeof(uint8_t)));
+
+        perturbKernel = cl::Kernel(programs[0], "mandelbrot_perturb");
+        shortcutKernel = cl::Kernel(programs[0], "mandelbrot_shortcut");
+        counterBuffer = cl::Buffer(contexts[0], CL_MEM_READ_WRITE, 3 * sizeof(int));
+        glitchBuffer = cl::Buffer(contexts[0], CL_MEM_READ_WRITE, width * height * sizeof(uint8_t));
+        orbitBytes = (256 + 1) * 2 * sizeof(double);
+        orbitBuffer = cl::Buffer(contexts[0], CL_MEM_READ_ONLY, orbitBytes);
+        fieldKernel = cl::Kernel(programs[0], "mandelbrot_field");
+        antialiasKernel = cl::Kernel(programs[0], "mandelbrot_supersample");
+        ddKernel = cl::Kernel(programs[0], "mandelbrot_dd");
+        fieldBuffer = cl::Buffer(contexts[0], CL_MEM_READ_WRITE, width * height * sizeof(uint16_t));
+        viewKernel = cl::Kernel(programs[0], "mandelbrot_view");
+        viewBuffer = cl::Buffer(contexts[0], CL_MEM_WRITE_ONLY, width * height * 4);
+        batchKernel = cl::Kernel(programs[0], "mandelbrot_batch");
     }
 
     void cleanupOpenCL() {
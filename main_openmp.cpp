@@ -1,57 +1,313 @@
+#pragma once
 #include <iostream>
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
 #include <omp.h>
+#include "main_trace.cpp"
+#include "main_outputview.cpp"
+#include "main_formula.cpp"
 
+// 将迭代次数映射为 RGB 颜色, 所有 CPU 引擎共用, 保证输出逐字节一致
+inline void mandelbrot_color(int iter, int max_iter, uint8_t* pixel) {
+    double t = static_cast<double>(iter) / max_iter;
+    uint8_t r, g, b;
+
+    if (iter == max_iter) {
+        r = g = b = 0; // 黑色
+    } else {
+        double t1 = 1 - t;
+        r = static_cast<uint8_t>(9 * t1 * t * t * t * 255);
+        g = static_cast<uint8_t>(15 * t1 * t1 * t * t * 255);
+        b = static_cast<uint8_t>(8.5 * t1 * t1 * t1 * t * 255);
+    }
+
+    pixel[0] = r;
+    pixel[1] = g;
+    pixel[2] = b;
+}
+
+// 单个像素的逃逸迭代次数, 所有 CPU 引擎共用; 迭代公式见 main_formula.cpp
 template<typename T>
-void mandelbrot_omp(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y) {
-    #pragma omp parallel for collapse(2)
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            T dx = (x_finish - x_start) / width;
-            T dy = (y_finish - y_start) / height;
-            T real = x_start + x * dx;
-            T imag = y_start + y * dy;
+inline int mandelbrot_escape(T c_real, T c_imag, int max_iter) {
+    return formula_escape(MandelbrotFormula(), c_real, c_imag, max_iter);
+}
 
-            T c_real = real;
-            T c_imag = imag;
+// 与 mandelbrot_escape 相同的迭代, 另外返回连续迭代次数 iter + 1 - log2(ln|z|), 集合内部为 max_iter
+template<typename T>
+inline int mandelbrot_escape_smooth(T c_real, T c_imag, int max_iter, float& smooth) {
+    T real = c_real;
+    T imag = c_imag;
+    int iter = 0;
+    T real2, imag2;
 
-            int max_iter = 256;
-            int iter = 0;
-            T real2, imag2;
+    for (int i = 0; i < max_iter; ++i) {
+        real2 = real * real;
+        imag2 = imag * imag;
+        if (real2 + imag2 > 4.0) {
+            double norm = static_cast<double>(real2 + imag2);
+            smooth = static_cast<float>(iter + 1 - std::log2(0.5 * std::log(norm)));
+            return iter;
+        }
+        MandelbrotFormula().step(real, imag, real2, imag2, c_real, c_imag);
+        iter++;
+    }
+    smooth = static_cast<float>(max_iter);
+    return iter;
+}
 
-            for (int i = 0; i < max_iter; ++i) {
-                real2 = real * real;
-                imag2 = imag * imag;
-                if (real2 + imag2 > 4.0) {
-                    break;
+// 按像素格式写一个像素并返回迭代次数; Format 是编译期常量, 分支在内联后消失
+template<int Format, typename T>
+inline int mandelbrot_store(uint8_t* pixel, T c_real, T c_imag, int max_iter) {
+    if (Format == PIXEL_SMOOTH32F) {
+        float smooth;
+        int iter = mandelbrot_escape_smooth(c_real, c_imag, max_iter, smooth);
+        std::memcpy(pixel, &smooth, sizeof(smooth));
+        return iter;
+    }
+    int iter = mandelbrot_escape(c_real, c_imag, max_iter);
+    if (Format == PIXEL_ITER16) {
+        uint16_t value = static_cast<uint16_t>(iter);
+        std::memcpy(pixel, &value, sizeof(value));
+    } else if (Format == PIXEL_RGBA8) {
+        // 先在寄存器中拼好再一次写出 4 字节
+        uint8_t color[4] = {0, 0, 0, 255};
+        mandelbrot_color(iter, max_iter, color);
+        std::memcpy(pixel, color, sizeof(color));
+    } else {
+        mandelbrot_color(iter, max_iter, pixel);
+    }
+    return iter;
+}
+
+// 常用的迭代上限在编译期实例化: body 收到 std::integral_constant, 内联后循环上界是常量,
+// 编译器可以展开; 其它上限收到普通 int, 走运行时上界.
+template<typename Body>
+inline void with_max_iter(int max_iter, Body body) {
+    switch (max_iter) {
+        case 256: body(std::integral_constant<int, 256>()); break;
+        case 512: body(std::integral_constant<int, 512>()); break;
+        case 1024: body(std::integral_constant<int, 1024>()); break;
+        case 2048: body(std::integral_constant<int, 2048>()); break;
+        case 4096: body(std::integral_constant<int, 4096>()); break;
+        case 8192: body(std::integral_constant<int, 8192>()); break;
+        default: body(max_iter); break;
+    }
+}
+
+inline bool is_specialised_max_iter(int max_iter) {
+    return max_iter >= 256 && max_iter <= 8192 && (max_iter & (max_iter - 1)) == 0;
+}
+
+// 内部快捷路径的统计: 每种捷径跳过了多少像素
+struct ShortcutStats {
+    long long cardioid = 0;   // 主心形区域, 解析判定
+    long long bulb = 0;       // 周期 2 圆盘, 解析判定
+    long long periodic = 0;   // 轨道出现精确循环, 提前结束
+};
+
+enum Shortcut {
+    SHORTCUT_NONE = 0,
+    SHORTCUT_CARDIOID = 1,
+    SHORTCUT_BULB = 2,
+    SHORTCUT_PERIODIC = 3
+};
+
+// 与 mandelbrot_escape 结果一致, 但对集合内部的点提前返回 max_iter:
+// 先解析判断主心形和周期 2 圆盘, 再用 Brent 方法检测轨道循环.
+// 循环判定要求 z 与保存值完全相等, 一旦成立轨道必然永远不逃逸, 因此不会改变任何像素的结果.
+template<typename T>
+inline int mandelbrot_escape_shortcut(T c_real, T c_imag, int max_iter, int& shortcut) {
+    T q_real = c_real - T(0.25);
+    T imag2 = c_imag * c_imag;
+    T q = q_real * q_real + imag2;
+    if (q * (q + q_real) < T(0.25) * imag2) {
+        shortcut = SHORTCUT_CARDIOID;
+        return max_iter;
+    }
+    T b_real = c_real + 1;
+    if (b_real * b_real + imag2 < T(0.0625)) {
+        shortcut = SHORTCUT_BULB;
+        return max_iter;
+    }
+
+    T real = c_real;
+    T imag = c_imag;
+    T saved_real = real;
+    T saved_imag = imag;
+    int period = 0;
+    int power = 1;
+    int iter = 0;
+    T real2;
+
+    for (int i = 0; i < max_iter; ++i) {
+        real2 = real * real;
+        imag2 = imag * imag;
+        if (real2 + imag2 > 4.0) {
+            break;
+        }
+        MandelbrotFormula().step(real, imag, real2, imag2, c_real, c_imag);
+        iter++;
+
+        if (real == saved_real && imag == saved_imag) {
+            shortcut = SHORTCUT_PERIODIC;
+            return max_iter;
+        }
+        if (++period == power) {
+            period = 0;
+            power *= 2;
+            saved_real = real;
+            saved_imag = imag;
+        }
+    }
+    shortcut = SHORTCUT_NONE;
+    return iter;
+}
+
+// shortcuts 非空时启用内部快捷路径, 并把每种捷径命中的像素数累加进去
+template<typename T>
+void mandelbrot_omp(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, ShortcutStats* shortcuts = nullptr,
+                    int max_iter = 256) {
+    if (shortcuts) {
+        long long cardioid = 0, bulb = 0, periodic = 0;
+        with_max_iter(max_iter, [&](auto limit) {
+            #pragma omp parallel for collapse(2) reduction(+:cardioid, bulb, periodic)
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    T dx = (x_finish - x_start) / width;
+                    T dy = (y_finish - y_start) / height;
+                    T real = x_start + x * dx;
+                    T imag = y_start + y * dy;
+
+                    int shortcut;
+                    int iter = mandelbrot_escape_shortcut(real, imag, limit, shortcut);
+                    cardioid += (shortcut == SHORTCUT_CARDIOID);
+                    bulb += (shortcut == SHORTCUT_BULB);
+                    periodic += (shortcut == SHORTCUT_PERIODIC);
+
+                    int idx = y * width * 3 + x * 3;
+                    mandelbrot_color(iter, limit, output + idx);
                 }
-                imag = 2 * real * imag + c_imag;
-                real = real2 - imag2 + c_real;
-                iter++;
             }
+        });
+        shortcuts->cardioid += cardioid;
+        shortcuts->bulb += bulb;
+        shortcuts->periodic += periodic;
+        return;
+    }
 
-            double t = static_cast<double>(iter) / max_iter;
-            uint8_t r, g, b;
+    mandelbrot_omp(OutputView(output, width, height), width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, max_iter);
+}
 
-            if (iter == max_iter) {
-                r = g = b = 0; // 黑色
-            } else {
-                double t1 = 1 - t;
-                r = static_cast<uint8_t>(9 * t1 * t * t * t * 255);
-                g = static_cast<uint8_t>(15 * t1 * t1 * t * t * 255);
-                b = static_cast<uint8_t>(8.5 * t1 * t1 * t1 * t * 255);
+// 写入输出视图: 行距, 方向和像素格式由 output 决定, 结果直接落在最终位置
+template<typename T>
+void mandelbrot_omp(const OutputView& output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+    with_pixel_format(output.format, [&](auto format) {
+        constexpr int bytes = decltype(format)::value == PIXEL_RGB8 ? 3 : decltype(format)::value == PIXEL_ITER16 ? 2 : 4;
+        with_max_iter(max_iter, [&](auto limit) {
+            auto pixel = [&](int x, int y) {
+                T dx = (x_finish - x_start) / width;
+                T dy = (y_finish - y_start) / height;
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+
+                return mandelbrot_store<decltype(format)::value>(output.row(y) + x * bytes, real, imag, limit);
+            };
+
+            // 插桩时按 tile 分配同一个像素计算, 每个 tile 记录一个带迭代总数的 span
+            if (Tracer::enabled()) {
+                TraceScope frame("mandelbrot_omp", "cpu");
+                const int tile = 64;
+                int tiles_x = (width + tile - 1) / tile;
+                int tiles_y = (height + tile - 1) / tile;
+                #pragma omp parallel for schedule(dynamic)
+                for (int t = 0; t < tiles_x * tiles_y; ++t) {
+                    TraceScope span("tile", "cpu");
+                    int x0 = (t % tiles_x) * tile, y0 = (t / tiles_x) * tile;
+                    long long total = 0;
+                    for (int y = y0; y < std::min(y0 + tile, height); ++y) {
+                        for (int x = x0; x < std::min(x0 + tile, width); ++x) {
+                            total += pixel(x, y);
+                        }
+                    }
+                    span.count("iterations", total);
+                }
+                return;
             }
 
-            int idx = y * width * 3 + x * 3;
-            output[idx] = r;
-            output[idx + 1] = g;
-            output[idx + 2] = b;
+            #pragma omp parallel for collapse(2)
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    pixel(x, y);
+                }
+            }
+        });
+    });
+}
+
+// 任意逃逸时间公式的 OpenMP 引擎, 采样和着色与 mandelbrot_omp 相同; 每种公式和迭代上限各自实例化一个循环
+template<typename Formula, typename T>
+void fractal_omp(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, const Formula& formula,
+                 int max_iter = 256) {
+    T dx = (x_finish - x_start) / width;
+    T dy = (y_finish - y_start) / height;
+    with_max_iter(max_iter, [&](auto limit) {
+        #pragma omp parallel for collapse(2)
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+                int iter = formula_escape(formula, real, imag, limit);
+                mandelbrot_color(iter, limit, output + (y * width + x) * 3);
+            }
         }
-    }
+    });
+}
+
+// 运行时选择分形, 在循环外分派到对应的公式
+template<typename T>
+void fractal_omp(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, const FractalSpec& spec,
+                 int max_iter = 256) {
+    with_formula(spec, [&](const auto& formula) {
+        fractal_omp(output, width, height, x_start, x_finish, y_start, y_finish, center_x, center_y, formula, max_iter);
+    });
+}
+
+// 批量渲染中的一张图像: 视口和输出缓冲区, 输出布局与单张渲染相同 (width * height * 3 字节 RGB)
+template<typename T>
+struct BatchViewport {
+    T x_start, x_finish, y_start, y_finish;
+    uint8_t* output;
+};
+
+// 同样大小的许多张小图像在一个并行区域内渲染, 工作单位是 (图像, 行), 线程之间跨图像动态分配.
+// 每张图像单独调用 mandelbrot_omp 时, 64x64 这样的小图像大部分时间花在创建并行区域和等待上
+template<typename T>
+void mandelbrot_omp_batch(const std::vector<BatchViewport<T>>& views, int width, int height, int max_iter = 256) {
+    int count = static_cast<int>(views.size());
+    with_max_iter(max_iter, [&](auto limit) {
+        #pragma omp parallel for collapse(2) schedule(dynamic, 4)
+        for (int image = 0; image < count; ++image) {
+            for (int y = 0; y < height; ++y) {
+                const BatchViewport<T>& view = views[image];
+                T dx = (view.x_finish - view.x_start) / width;
+                T dy = (view.y_finish - view.y_start) / height;
+                T imag = view.y_start + y * dy;
+                uint8_t* row = view.output + static_cast<size_t>(y) * width * 3;
+                for (int x = 0; x < width; ++x) {
+                    T real = view.x_start + x * dx;
+                    mandelbrot_color(mandelbrot_escape(real, imag, limit), limit, row + x * 3);
+                }
+            }
+        }
+    });
 }
 
 template<typename T>
-void mandelbrot_single_thread(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y) {
+void mandelbrot_single_thread(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, ShortcutStats* shortcuts = nullptr,
+                              int max_iter = 256) {
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
             T dx = (x_finish - x_start) / width;
@@ -59,40 +315,19 @@ void mandelbrot_single_thread(uint8_t* output, int width, int height, T x_start,
             T real = x_start + x * dx;
             T imag = y_start + y * dy;
 
-            T c_real = real;
-            T c_imag = imag;
-
-            int max_iter = 256;
-            int iter = 0;
-            T real2, imag2;
-
-            for (int i = 0; i < max_iter; ++i) {
-                real2 = real * real;
-                imag2 = imag * imag;
-                if (real2 + imag2 > 4.0) {
-                    break;
-                }
-                imag = 2 * real * imag + c_imag;
-                real = real2 - imag2 + c_real;
-                iter++;
-            }
-
-            double t = static_cast<double>(iter) / max_iter;
-            uint8_t r, g, b;
-
-            if (iter == max_iter) {
-                r = g = b = 0; // 黑色
+            int iter;
+            if (shortcuts) {
+                int shortcut;
+                iter = mandelbrot_escape_shortcut(real, imag, max_iter, shortcut);
+                shortcuts->cardioid += (shortcut == SHORTCUT_CARDIOID);
+                shortcuts->bulb += (shortcut == SHORTCUT_BULB);
+                shortcuts->periodic += (shortcut == SHORTCUT_PERIODIC);
             } else {
-                double t1 = 1 - t;
-                r = static_cast<uint8_t>(9 * t1 * t * t * t * 255);
-                g = static_cast<uint8_t>(15 * t1 * t1 * t * t * 255);
-                b = static_cast<uint8_t>(8.5 * t1 * t1 * t1 * t * 255);
+                iter = mandelbrot_escape(real, imag, max_iter);
             }
 
             int idx = y * width * 3 + x * 3;
-            output[idx] = r;
-            output[idx + 1] = g;
-            output[idx + 2] = b;
+            mandelbrot_color(iter, max_iter, output + idx);
         }
     }
 }
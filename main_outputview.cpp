@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <type_traits>
+
+// 输出视图: 引擎把结果直接写到最终位置 (子矩形, 带行填充的图像, 内存映射文件), 不再经过紧密排列的中间缓冲区.
+enum PixelFormat {
+    PIXEL_RGB8 = 0,       // 3 字节 RGB, 与原来的输出相同
+    PIXEL_RGBA8 = 1,      // 4 字节 RGBA, A 恒为 255, 每像素一次 32 位写入
+    PIXEL_ITER16 = 2,     // uint16 迭代次数, 与 mandelbrot_field 相同
+    PIXEL_SMOOTH32F = 3   // float 连续迭代次数, 集合内部为 max_iter
+};
+
+inline int pixel_size(PixelFormat format) {
+    switch (format) {
+        case PIXEL_RGB8: return 3;
+        case PIXEL_RGBA8: return 4;
+        case PIXEL_ITER16: return 2;
+        default: return 4;
+    }
+}
+
+// 图像上方对应 y_finish. TOP_DOWN 时内存中第一行是图像顶部 (PNG / Y4M 的顺序),
+// BOTTOM_UP 时第一行是 y_start 所在的底部 (OpenGL 纹理和原来紧密缓冲区的顺序)
+enum Orientation {
+    TOP_DOWN = 0,
+    BOTTOM_UP = 1
+};
+
+struct OutputView {
+    uint8_t* origin = nullptr;   // 引擎第 0 行 (y_start) 的第一个像素
+    ptrdiff_t stride = 0;        // 引擎相邻两行的字节距离, TOP_DOWN 时为负
+    PixelFormat format = PIXEL_RGB8;
+
+    OutputView() = default;
+
+    // data 指向区域中地址最低的一行; row_bytes 为 0 时按 width 紧密排列,
+    // 写入大图中的子矩形时 data 指向子矩形的第一个像素, row_bytes 为大图的行字节数
+    OutputView(uint8_t* data, int width, int height, PixelFormat format = PIXEL_RGB8, Orientation orientation = BOTTOM_UP, size_t row_bytes = 0)
+        : format(format) {
+        ptrdiff_t bytes = row_bytes ? static_cast<ptrdiff_t>(row_bytes) : static_cast<ptrdiff_t>(width) * pixel_size(format);
+        if (orientation == TOP_DOWN) {
+            origin = data + (height - 1) * bytes;
+            stride = -bytes;
+        } else {
+            origin = data;
+            stride = bytes;
+        }
+    }
+
+    uint8_t* row(int y) const { return origin + y * stride; }
+
+    Orientation orientation() const { return stride < 0 ? TOP_DOWN : BOTTOM_UP; }
+    size_t rowBytes() const { return static_cast<size_t>(std::abs(stride)); }
+
+    // 区域中地址最低的一行, 按正的行距整块拷贝时使用
+    uint8_t* base(int height) const { return stride < 0 ? row(height - 1) : origin; }
+};
+
+// 与 with_max_iter 相同的做法: 像素格式在循环外分派, 循环体收到编译期常量
+template<typename Body>
+inline void with_pixel_format(PixelFormat format, Body body) {
+    switch (format) {
+        case PIXEL_RGB8: body(std::integral_constant<int, PIXEL_RGB8>()); break;
+        case PIXEL_RGBA8: body(std::integral_constant<int, PIXEL_RGBA8>()); break;
+        case PIXEL_ITER16: body(std::integral_constant<int, PIXEL_ITER16>()); break;
+        default: body(std::integral_constant<int, PIXEL_SMOOTH32F>()); break;
+    }
+}
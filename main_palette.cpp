@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+
+// 迭代场与着色分离: 引擎只输出每像素 2 字节的迭代次数, 着色通过预先计算的调色板查表完成,
+// 更换调色板时只需重跑查表这一步.
+class Palette {
+public:
+    enum Kind {
+        CLASSIC = 0,   // 与 mandelbrot_color 逐字节一致
+        FIRE = 1,
+        GREY = 2,
+        COUNT = 3
+    };
+
+    explicit Palette(Kind kind = CLASSIC, int max_iter = 256) : kind(kind), max_iter(max_iter), lut((max_iter + 1) * 3) {
+        for (int iter = 0; iter <= max_iter; ++iter) {
+            uint8_t* pixel = &lut[iter * 3];
+            double t = static_cast<double>(iter) / max_iter;
+            if (kind == CLASSIC || iter == max_iter) {
+                mandelbrot_color(iter, max_iter, pixel);
+            } else if (kind == FIRE) {
+                pixel[0] = static_cast<uint8_t>(255 * std::min(1.0, 3 * t));
+                pixel[1] = static_cast<uint8_t>(255 * std::min(1.0, std::max(0.0, 3 * t - 1)));
+                pixel[2] = static_cast<uint8_t>(255 * std::max(0.0, 3 * t - 2));
+            } else {
+                pixel[0] = pixel[1] = pixel[2] = static_cast<uint8_t>(255 * std::sqrt(t));
+            }
+        }
+    }
+
+    Kind getKind() const { return kind; }
+    int maxIter() const { return max_iter; }
+    const uint8_t* data() const { return lut.data(); }
+
+    static const char* name(Kind kind) {
+        switch (kind) {
+            case CLASSIC: return "classic";
+            case FIRE: return "fire";
+            case GREY: return "grey";
+            default: return "unknown";
+        }
+    }
+
+private:
+    Kind kind;
+    int max_iter;
+    std::vector<uint8_t> lut;
+};
+
+// 迭代场: 与 mandelbrot_omp 的采样方式相同, 只是不着色; max_iter 不能超过 uint16 的范围
+template<typename T>
+void mandelbrot_field(uint16_t* iters, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, int max_iter = 256) {
+    T dx = (x_finish - x_start) / width;
+    T dy = (y_finish - y_start) / height;
+
+    with_max_iter(max_iter, [&](auto limit) {
+        #pragma omp parallel for schedule(dynamic)
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+                iters[y * width + x] = static_cast<uint16_t>(mandelbrot_escape(real, imag, limit));
+            }
+        }
+    });
+}
+
+// 着色: 每个像素一次查表, 迭代次数超出调色板范围时按集合内部处理
+inline void colorize(const uint16_t* iters, int count, const Palette& palette, uint8_t* output) {
+    const uint8_t* lut = palette.data();
+    int max_iter = palette.maxIter();
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < count; ++i) {
+        int iter = std::min(static_cast<int>(iters[i]), max_iter);
+        const uint8_t* color = lut + iter * 3;
+        output[i * 3] = color[0];
+        output[i * 3 + 1] = color[1];
+        output[i * 3 + 2] = color[2];
+    }
+}
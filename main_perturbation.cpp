@@ -0,0 +1,298 @@
+#pragma once
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <omp.h>
+#include "main_openmp.cpp"
+#include "main_doubledouble.cpp"
+
+// 定点高精度数: limbs[0] 为整数部分, limbs[i] 的权重为 2^(-32 i), 符号单独存放.
+// 只用于计算参考轨道, 每帧只有一个像素走这条路径, 因此用最简单的 O(n^2) 乘法.
+class BigFixed {
+public:
+    BigFixed() : negative(false), limbs(1, 0) {}
+
+    BigFixed(double value, int count) : negative(value < 0), limbs(count, 0) {
+        double v = std::fabs(value);
+        for (int i = 0; i < count; ++i) {
+            double part = std::floor(v);
+            limbs[i] = static_cast<uint32_t>(part);
+            v = (v - part) * 4294967296.0;
+        }
+    }
+
+    int size() const { return static_cast<int>(limbs.size()); }
+
+    double toDouble() const {
+        double result = 0.0;
+        for (size_t i = 0; i < limbs.size(); ++i) {
+            result += std::ldexp(static_cast<double>(limbs[i]), -32 * static_cast<int>(i));
+        }
+        return negative ? -result : result;
+    }
+
+    BigFixed operator+(const BigFixed& other) const {
+        BigFixed result;
+        if (negative == other.negative) {
+            result.limbs = addMagnitude(limbs, other.limbs);
+            result.negative = negative;
+        } else if (compareMagnitude(limbs, other.limbs) >= 0) {
+            result.limbs = subMagnitude(limbs, other.limbs);
+            result.negative = negative;
+        } else {
+            result.limbs = subMagnitude(other.limbs, limbs);
+            result.negative = other.negative;
+        }
+        return result;
+    }
+
+    BigFixed operator-(const BigFixed& other) const {
+        BigFixed negated = other;
+        negated.negative = !other.negative;
+        return *this + negated;
+    }
+
+    BigFixed operator*(const BigFixed& other) const {
+        size_t n = limbs.size();
+        // 转成小端整数相乘, 再右移 (n - 1) 个 limb 回到定点格式
+        std::vector<uint32_t> product(2 * n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t a = limbs[n - 1 - i];
+            uint64_t carry = 0;
+            for (size_t j = 0; j < n; ++j) {
+                uint64_t t = a * other.limbs[n - 1 - j] + product[i + j] + carry;
+                product[i + j] = static_cast<uint32_t>(t);
+                carry = t >> 32;
+            }
+            product[i + n] = static_cast<uint32_t>(carry);
+        }
+
+        BigFixed result;
+        result.limbs.assign(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            result.limbs[i] = product[2 * n - 2 - i];
+        }
+        result.negative = (negative != other.negative);
+        return result;
+    }
+
+private:
+    bool negative;
+    std::vector<uint32_t> limbs;
+
+    static int compareMagnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i] != b[i]) {
+                return a[i] < b[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    static std::vector<uint32_t> addMagnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> result(a.size());
+        uint64_t carry = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            uint64_t t = static_cast<uint64_t>(a[i]) + b[i] + carry;
+            result[i] = static_cast<uint32_t>(t);
+            carry = t >> 32;
+        }
+        return result;
+    }
+
+    static std::vector<uint32_t> subMagnitude(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+        std::vector<uint32_t> result(a.size());
+        int64_t borrow = 0;
+        for (size_t i = a.size(); i-- > 0;) {
+            int64_t t = static_cast<int64_t>(a[i]) - b[i] - borrow;
+            borrow = t < 0 ? 1 : 0;
+            result[i] = static_cast<uint32_t>(t + (borrow << 32));
+        }
+        return result;
+    }
+};
+
+// 参考轨道 Z_0 = 0, Z_1 = C, ... 直到逃逸或达到 max_iter, 以低精度保存
+template<typename D>
+struct ReferenceOrbit {
+    std::vector<D> re;
+    std::vector<D> im;
+
+    int last() const { return static_cast<int>(re.size()) - 1; }
+};
+
+struct PerturbationOptions {
+    bool rebase = true;             // |z| < |delta| 或参考轨道用完时重置到 Z_0
+    int max_references = 16;        // 含主参考点在内的最大参考轨道数
+    double glitch_tolerance = 1e-6; // Pauldelbrot 判据: |z|^2 < tol * |Z|^2 视为 glitch
+};
+
+struct PerturbationStats {
+    int references = 0;
+    long long glitched = 0;   // 所有参考轨道都无法修复的像素
+};
+
+// 每 32 位提供约 1e-9.6 的分辨率, 额外留出两个 limb 作为保护位
+inline int perturbation_limbs(double scale, int width, int height) {
+    double pixel = scale / std::max(width, height);
+    int bits = static_cast<int>(std::ceil(-std::log2(pixel))) + 64;
+    return 1 + std::max(2, (bits + 31) / 32);
+}
+
+// 参考点的中心以 double-double 传入, 两个分量分别转换后相加, 不会在 double 精度处截断
+inline BigFixed bigfixed_from(const dd_real& value, int limbs) {
+    return BigFixed(value.hi, limbs) + BigFixed(value.lo, limbs);
+}
+
+template<typename D>
+ReferenceOrbit<D> compute_reference_orbit(const BigFixed& c_re, const BigFixed& c_im, int max_iter) {
+    ReferenceOrbit<D> orbit;
+    orbit.re.reserve(max_iter + 1);
+    orbit.im.reserve(max_iter + 1);
+    orbit.re.push_back(0);
+    orbit.im.push_back(0);
+
+    BigFixed z_re(0.0, c_re.size());
+    BigFixed z_im(0.0, c_im.size());
+    for (int i = 0; i < max_iter; ++i) {
+        BigFixed re2 = z_re * z_re;
+        BigFixed im2 = z_im * z_im;
+        BigFixed re_im = z_re * z_im;
+        z_im = re_im + re_im + c_im;
+        z_re = re2 - im2 + c_re;
+
+        double zr = z_re.toDouble();
+        double zi = z_im.toDouble();
+        orbit.re.push_back(static_cast<D>(zr));
+        orbit.im.push_back(static_cast<D>(zi));
+        if (zr * zr + zi * zi > 4.0) {
+            break;
+        }
+    }
+    return orbit;
+}
+
+// 与 mandelbrot_single_thread 的计数方式一致: 返回第一次 |z_k| > 2 时的 k - 1
+template<typename D>
+int perturb_pixel(const ReferenceOrbit<D>& orbit, D dc_re, D dc_im, int max_iter, bool rebase, D glitch_tolerance, bool& glitched) {
+    const D* ref_re = orbit.re.data();
+    const D* ref_im = orbit.im.data();
+    int last = orbit.last();
+    D d_re = 0, d_im = 0;
+    int m = 0;
+    glitched = false;
+
+    for (int k = 1; k <= max_iter; ++k) {
+        D z_re = ref_re[m], z_im = ref_im[m];
+        D n_re = 2 * (z_re * d_re - z_im * d_im) + (d_re * d_re - d_im * d_im) + dc_re;
+        D n_im = 2 * (z_re * d_im + z_im * d_re) + 2 * d_re * d_im + dc_im;
+        d_re = n_re;
+        d_im = n_im;
+        ++m;
+
+        z_re = ref_re[m] + d_re;
+        z_im = ref_im[m] + d_im;
+        D mag = z_re * z_re + z_im * z_im;
+        if (mag > 4) {
+            return k - 1;
+        }
+
+        D ref_mag = ref_re[m] * ref_re[m] + ref_im[m] * ref_im[m];
+        bool glitch = mag < glitch_tolerance * ref_mag;
+        bool exhausted = (m == last && k < max_iter);
+        if (rebase) {
+            if (glitch || exhausted || mag < d_re * d_re + d_im * d_im) {
+                d_re = z_re;
+                d_im = z_im;
+                m = 0;
+            }
+        } else if (glitch || exhausted) {
+            glitched = true;
+            return k;
+        }
+    }
+    return max_iter;
+}
+
+// 用 (center, scale) 描述视口, 与 updateParameters 的映射一致: x_start = center_x - 0.5 * ratio * scale.
+// 中心保持 double-double 精度, 只有像素相对参考点的偏移用 double
+template<typename D>
+void perturbation_iterations(std::vector<int>& iters, int width, int height, const dd_real& center_x, const dd_real& center_y, double scale, double ratio,
+                             const PerturbationOptions& options, PerturbationStats* stats, int max_iter) {
+    int limbs = perturbation_limbs(scale, width, height);
+    double dx = ratio * scale / width;
+    double dy = scale / height;
+    double half_w = 0.5 * ratio * scale;
+    double half_h = 0.5 * scale;
+
+    BigFixed c_re = bigfixed_from(center_x, limbs), c_im = bigfixed_from(center_y, limbs);
+    double offset_re = 0.0, offset_im = 0.0;
+
+    std::vector<int> pending(width * height);
+    for (int i = 0; i < width * height; ++i) {
+        pending[i] = i;
+    }
+    std::vector<uint8_t> glitched(width * height, 0);
+
+    int references = 0;
+    while (!pending.empty()) {
+        ReferenceOrbit<D> orbit = compute_reference_orbit<D>(c_re, c_im, max_iter);
+        ++references;
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int p = 0; p < static_cast<int>(pending.size()); ++p) {
+            int idx = pending[p];
+            int x = idx % width;
+            int y = idx / width;
+            double dc_re = x * dx - half_w - offset_re;
+            double dc_im = y * dy - half_h - offset_im;
+            bool glitch;
+            iters[idx] = perturb_pixel(orbit, static_cast<D>(dc_re), static_cast<D>(dc_im), max_iter, options.rebase,
+                                       static_cast<D>(options.glitch_tolerance), glitch);
+            glitched[idx] = glitch;
+        }
+
+        std::vector<int> next;
+        for (int idx : pending) {
+            if (glitched[idx]) {
+                next.push_back(idx);
+            }
+        }
+        pending.swap(next);
+        if (pending.empty() || references >= options.max_references) {
+            break;
+        }
+
+        // 以一个 glitch 像素作为次级参考点, 剩余 glitch 像素相对它重新计算
+        int idx = pending[pending.size() / 2];
+        offset_re = (idx % width) * dx - half_w;
+        offset_im = (idx / width) * dy - half_h;
+        c_re = bigfixed_from(center_x, limbs) + BigFixed(offset_re, limbs);
+        c_im = bigfixed_from(center_y, limbs) + BigFixed(offset_im, limbs);
+    }
+
+    if (stats) {
+        stats->references = references;
+        stats->glitched = static_cast<long long>(pending.size());
+    }
+}
+
+// 深度缩放: 参考轨道高精度计算, 每个像素只迭代低精度的差值.
+// float 的差值在约 1e-30 以下会下溢, 因此更深时自动改用 double 差值.
+template<typename T>
+void mandelbrot_perturbation(uint8_t* output, int width, int height, const dd_real& center_x, const dd_real& center_y, double scale, double ratio,
+                             const PerturbationOptions& options = PerturbationOptions(), PerturbationStats* stats = nullptr, int max_iter = 256) {
+    std::vector<int> iters(width * height);
+    if (std::is_same<T, float>::value && scale > 1e-30) {
+        perturbation_iterations<float>(iters, width, height, center_x, center_y, scale, ratio, options, stats, max_iter);
+    } else {
+        perturbation_iterations<double>(iters, width, height, center_x, center_y, scale, ratio, options, stats, max_iter);
+    }
+
+    #pragma omp parallel for
+    for (int i = 0; i < width * height; ++i) {
+        mandelbrot_color(iters[i], max_iter, output + i * 3);
+    }
+}
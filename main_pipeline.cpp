@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include "lodepng.h"
+
+// 有界阻塞队列, 连接流水线的各个阶段: 队列满时生产者阻塞, 从而限制在途帧数和内存占用.
+// close() 之后 push 失败, pop 取完剩余元素后返回 false.
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+    bool push(T item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_full.wait(guard, [this] { return items.size() < capacity || closed; });
+        if (closed) {
+            return false;
+        }
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard(lock);
+        not_empty.wait(guard, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(lock);
+        closed = true;
+        not_empty.notify_all();
+        not_full.notify_all();
+    }
+
+private:
+    size_t capacity;
+    bool closed;
+    std::deque<T> items;
+    std::mutex lock;
+    std::condition_variable not_empty, not_full;
+};
+
+// 计算结果第 0 行对应 y_start (图像底部), 写出前需要上下翻转
+inline void flipVertically(uint8_t* data, int width, int height) {
+    int row_size = width * 3;
+    std::vector<uint8_t> temp(row_size);
+    for (int i = 0; i < height / 2; ++i) {
+        uint8_t* row1 = data + i * row_size;
+        uint8_t* row2 = data + (height - i - 1) * row_size;
+        std::memcpy(temp.data(), row1, row_size);
+        std::memcpy(row1, row2, row_size);
+        std::memcpy(row2, temp.data(), row_size);
+    }
+}
+
+enum FrameFormat {
+    FORMAT_PNG = 0,   // 每帧一个 PNG 文件
+    FORMAT_RAW = 1,   // rgb24 原始帧, 写到 stdout
+    FORMAT_Y4M = 2    // YUV4MPEG2 (4:4:4), 写到 stdout
+};
+
+inline std::string y4m_header(int width, int height, int frame_rate) {
+    return "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) + " F" + std::to_string(frame_rate) +
+           ":1 Ip A1:1 C444\n";
+}
+
+// BT.601 有限范围 RGB -> YCbCr, 输出 "FRAME" 标记加三个平面
+inline std::vector<uint8_t> encode_y4m_frame(const uint8_t* rgb, int width, int height) {
+    static const char marker[] = "FRAME\n";
+    size_t plane = static_cast<size_t>(width) * height;
+    std::vector<uint8_t> out(sizeof(marker) - 1 + plane * 3);
+    std::memcpy(out.data(), marker, sizeof(marker) - 1);
+    uint8_t* y_plane = out.data() + sizeof(marker) - 1;
+    uint8_t* u_plane = y_plane + plane;
+    uint8_t* v_plane = u_plane + plane;
+
+    for (size_t i = 0; i < plane; ++i) {
+        int r = rgb[i * 3], g = rgb[i * 3 + 1], b = rgb[i * 3 + 2];
+        y_plane[i] = static_cast<uint8_t>(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+        u_plane[i] = static_cast<uint8_t>(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+        v_plane[i] = static_cast<uint8_t>(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+    }
+    return out;
+}
+
+// 编码阶段: 翻转并按格式编码, 返回可以直接写出的字节; 引擎已按 TOP_DOWN 写出时 flip 为 false
+inline std::vector<uint8_t> encode_frame(std::vector<uint8_t>& pixels, int width, int height, FrameFormat format, bool flip = true) {
+    if (flip) {
+        flipVertically(pixels.data(), width, height);
+    }
+    if (format == FORMAT_Y4M) {
+        return encode_y4m_frame(pixels.data(), width, height);
+    }
+    if (format == FORMAT_RAW) {
+        return std::move(pixels);
+    }
+    std::vector<uint8_t> png;
+    unsigned error = lodepng::encode(png, pixels, width, height, LCT_RGB);
+    if (error) {
+        std::cerr << "PNG encode error: " << lodepng_error_text(error) << std::endl;
+        exit(1);
+    }
+    return png;
+}
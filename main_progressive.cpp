@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+#include "main_palette.cpp"
+
+// 由粗到细的渐进渲染: 第一遍只计算每 initial_step 个像素中的一个, 之后每遍步长减半,
+// 只计算新增的采样点 (坐标不是 2 * step 倍数的点), 已算过的采样不会重算.
+// 每遍结束后用当前分辨率的采样块状填充整帧, 最后一遍的结果与 mandelbrot_omp 逐字节一致.
+template<typename T>
+class ProgressiveRenderer {
+public:
+    ProgressiveRenderer(int width, int height, int initial_step = 16)
+        : width(width), height(height), initial_step(1), iters(width * height),
+          x_start(0), dx(0), y_start(0), dy(0), max_iter(256), step(0), computed_step(0) {
+        // 步长必须是 2 的幂, 否则逐遍减半后采样网格无法嵌套
+        while (this->initial_step * 2 <= initial_step) {
+            this->initial_step *= 2;
+        }
+    }
+
+    // 开始新的视口, 未完成的细化直接放弃
+    void begin(T view_x_start, T view_x_finish, T view_y_start, T view_y_finish, int view_max_iter = 256) {
+        if (palette.maxIter() != view_max_iter) {
+            palette = Palette(Palette::CLASSIC, view_max_iter);
+        }
+        max_iter = view_max_iter;
+        x_start = view_x_start;
+        y_start = view_y_start;
+        dx = (view_x_finish - view_x_start) / width;
+        dy = (view_y_finish - view_y_start) / height;
+        step = initial_step;
+        computed_step = 0;
+    }
+
+    // 计算下一遍并把当前分辨率的结果写入 output, 返回是否已经到达全分辨率
+    bool refine(uint8_t* output) {
+        if (finished()) {
+            return true;
+        }
+        int s = step;
+        bool first = (computed_step == 0);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int y = 0; y < height; y += s) {
+            // 2s 倍数的行上, 2s 倍数的列在上一遍已经算过
+            bool old_row = !first && (y % (2 * s) == 0);
+            int x_step = old_row ? 2 * s : s;
+            for (int x = old_row ? s : 0; x < width; x += x_step) {
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+                iters[y * width + x] = static_cast<uint16_t>(mandelbrot_escape(real, imag, max_iter));
+            }
+        }
+
+        computed_step = s;
+        step = s / 2;
+        fill(output);
+        return finished();
+    }
+
+    bool finished() const { return computed_step == 1; }
+    int currentStep() const { return computed_step; }
+
+private:
+    int width, height;
+    int initial_step;
+    std::vector<uint16_t> iters;
+    Palette palette;
+    T x_start, dx, y_start, dy;
+    int max_iter;
+    int step;            // 下一遍的步长
+    int computed_step;   // 已完成的最细步长, 0 表示还没有任何采样
+
+    void fill(uint8_t* output) {
+        int s = computed_step;
+        const uint8_t* lut = palette.data();
+
+        #pragma omp parallel for schedule(static)
+        for (int y = 0; y < height; ++y) {
+            const uint16_t* row = &iters[(y - y % s) * width];
+            uint8_t* out = output + y * width * 3;
+            for (int x = 0; x < width; ++x) {
+                const uint8_t* color = lut + row[x - x % s] * 3;
+                out[x * 3] = color[0];
+                out[x * 3 + 1] = color[1];
+                out[x * 3 + 2] = color[2];
+            }
+        }
+    }
+};
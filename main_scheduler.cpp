@@ -0,0 +1,151 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <numeric>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+
+// 按 tile 划分帧, 用上一帧每个 tile 的迭代总数估计代价, 代价高的先分配;
+// 每个线程拥有一个双端队列, 自己从队首取最贵的 tile, 空闲时从别人的队尾偷最便宜的.
+class TileScheduler {
+public:
+    explicit TileScheduler(int tile_size = 32) : tile_size(tile_size), tiles_x(0), tiles_y(0) {}
+
+    void setTileSize(int size) {
+        std::lock_guard<std::mutex> guard(running);
+        tile_size = std::max(1, size);
+        tiles_x = tiles_y = 0;
+    }
+
+    int tileSize() const { return tile_size; }
+
+    // render_tile(x0, y0, x1, y1) 渲染半开区间 [x0, x1) x [y0, y1) 并返回该 tile 的代价.
+    // 代价表属于调度器, 同一个调度器上的并发渲染依次执行; 需要并行渲染的调用方各自持有调度器
+    template<typename RenderTile>
+    void run(int width, int height, RenderTile render_tile) {
+        std::lock_guard<std::mutex> guard(running);
+        int grid_x = (width + tile_size - 1) / tile_size;
+        int grid_y = (height + tile_size - 1) / tile_size;
+        int count = grid_x * grid_y;
+        if (grid_x != tiles_x || grid_y != tiles_y) {
+            tiles_x = grid_x;
+            tiles_y = grid_y;
+            cost.assign(count, 1.0);
+        }
+
+        std::vector<int> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return cost[a] > cost[b]; });
+
+        int threads = omp_get_max_threads();
+        std::vector<WorkQueue> queues(threads);
+        for (int i = 0; i < count; ++i) {
+            queues[i % threads].tiles.push_back(order[i]);
+        }
+
+        #pragma omp parallel num_threads(threads)
+        {
+            int self = omp_get_thread_num();
+            int tile;
+            while (next(queues, self, tile)) {
+                int x0 = (tile % tiles_x) * tile_size;
+                int y0 = (tile / tiles_x) * tile_size;
+                int x1 = std::min(x0 + tile_size, width);
+                int y1 = std::min(y0 + tile_size, height);
+                cost[tile] = render_tile(x0, y0, x1, y1);
+            }
+        }
+    }
+
+private:
+    struct alignas(64) WorkQueue {
+        std::mutex lock;
+        std::deque<int> tiles;
+    };
+
+    std::mutex running;
+    int tile_size;
+    int tiles_x, tiles_y;
+    std::vector<double> cost;
+
+    static bool next(std::vector<WorkQueue>& queues, int self, int& tile) {
+        {
+            std::lock_guard<std::mutex> guard(queues[self].lock);
+            if (!queues[self].tiles.empty()) {
+                tile = queues[self].tiles.front();
+                queues[self].tiles.pop_front();
+                return true;
+            }
+        }
+        // 没有新任务会被加入, 所以一轮偷取全部失败即可结束
+        int n = static_cast<int>(queues.size());
+        for (int k = 1; k < n; ++k) {
+            WorkQueue& victim = queues[(self + k) % n];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tiles.empty()) {
+                tile = victim.tiles.back();
+                victim.tiles.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+inline TileScheduler& default_tile_scheduler() {
+    static TileScheduler scheduler;
+    return scheduler;
+}
+
+// 与 mandelbrot_omp 签名相同, 可直接替换; scheduler 为空时使用 default_tile_scheduler(),
+// tile 大小通过它的 setTileSize 配置
+template<typename T>
+void mandelbrot_omp_tiled(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, ShortcutStats* shortcuts = nullptr,
+                          int max_iter = 256, TileScheduler* scheduler = nullptr) {
+    T dx = (x_finish - x_start) / width;
+    T dy = (y_finish - y_start) / height;
+    std::mutex stats_lock;
+
+    bool tracing = Tracer::enabled();
+    (scheduler ? *scheduler : default_tile_scheduler()).run(width, height, [&](int x0, int y0, int x1, int y1) {
+        double started = tracing ? Tracer::instance().now() : 0.0;
+        long long total = 0;
+        ShortcutStats local;
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                T real = x_start + x * dx;
+                T imag = y_start + y * dy;
+
+                int iter;
+                if (shortcuts) {
+                    int shortcut;
+                    iter = mandelbrot_escape_shortcut(real, imag, max_iter, shortcut);
+                    local.cardioid += (shortcut == SHORTCUT_CARDIOID);
+                    local.bulb += (shortcut == SHORTCUT_BULB);
+                    local.periodic += (shortcut == SHORTCUT_PERIODIC);
+                    // 走捷径的像素几乎不花时间, 不计入代价
+                    total += (shortcut == SHORTCUT_NONE) ? iter : 1;
+                } else {
+                    iter = mandelbrot_escape(real, imag, max_iter);
+                    total += iter;
+                }
+
+                int idx = y * width * 3 + x * 3;
+                mandelbrot_color(iter, max_iter, output + idx);
+            }
+        }
+        if (tracing) {
+            Tracer::instance().record("tile", "cpu", started, Tracer::instance().now() - started, "iterations", total);
+        }
+        if (shortcuts) {
+            std::lock_guard<std::mutex> guard(stats_lock);
+            shortcuts->cardioid += local.cardioid;
+            shortcuts->bulb += local.bulb;
+            shortcuts->periodic += local.periodic;
+        }
+        return static_cast<double>(total);
+    });
+}
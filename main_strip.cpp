@@ -0,0 +1,117 @@
+#pragma once
+#include <cstdint>
+#include <climits>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include "main_opencl.cpp"
+#include "main_openmp.cpp"
+#include "main_pipeline.cpp"
+
+// 按水平条带渲染任意大小的图像, 峰值内存由 budget 决定而不是图像大小.
+// 条带自上而下计算并立即追加到 PPM (P6) 文件, 计算下一条带时写出线程同时写上一条带.
+struct StripOptions {
+    std::string engine = "omp";        // omp 或 opencl
+    size_t budget = 256u << 20;        // 条带缓冲区总字节数上限
+};
+
+struct StripStats {
+    int strip_rows = 0;
+    int strips = 0;
+};
+
+// 同时存在的条带缓冲区: 正在计算的一条, 队列中的一条, 正在写出的一条
+static const int strip_buffers = 3;
+
+inline int strip_rows_for_budget(int width, int height, size_t budget) {
+    size_t row_bytes = static_cast<size_t>(width) * 3;
+    size_t rows = budget / (strip_buffers * row_bytes);
+    // 引擎内部用 int 索引像素, 单个条带不能超过 INT_MAX 字节
+    rows = std::min(rows, static_cast<size_t>(INT_MAX) / row_bytes);
+    rows = std::min(rows, static_cast<size_t>(height));
+    if (rows == 0) {
+        std::cerr << "Memory budget too small for a single row of " << width << " pixels" << std::endl;
+        exit(1);
+    }
+    return static_cast<int>(rows);
+}
+
+// 视口与 updateParameters 的映射一致: 高度方向跨度为 scale, 宽度方向为 scale * width / height
+template<typename T>
+void render_strips(const std::string& filename, int width, int height, double center_x, double center_y, double scale,
+                   const StripOptions& options = StripOptions(), StripStats* stats = nullptr) {
+    double ratio = static_cast<double>(width) / height;
+    double x_start = center_x - 0.5 * ratio * scale;
+    double x_finish = center_x + 0.5 * ratio * scale;
+    double y_start = center_y - 0.5 * scale;
+    double dy = scale / height;
+
+    int rows = strip_rows_for_budget(width, height, options.budget);
+    int strips = (height + rows - 1) / rows;
+    size_t row_bytes = static_cast<size_t>(width) * 3;
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Failed to open output file: " << filename << std::endl;
+        exit(1);
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+
+    std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+    if (options.engine == "opencl") {
+        mandelbrotOpenCL.reset(new MandelbrotOpenCL(width, rows));
+    }
+
+    struct Strip {
+        std::vector<uint8_t> pixels;
+        int valid_rows = 0;
+    };
+    BoundedQueue<Strip> pending(strip_buffers - 2);
+
+    // 引擎的第 0 行是 y 最小的一行, 而 PPM 从图像顶部开始, 所以条带内逆序写出
+    std::thread writer([&]() {
+        Strip strip;
+        while (pending.pop(strip)) {
+            for (int j = 0; j < strip.valid_rows; ++j) {
+                const uint8_t* row = strip.pixels.data() + (rows - 1 - j) * row_bytes;
+                out.write(reinterpret_cast<const char*>(row), row_bytes);
+            }
+        }
+    });
+
+    for (int k = 0; k < strips; ++k) {
+        int top = k * rows;
+        // 最后一个条带不足 rows 行时, 多出的行落在视口下方, 计算后丢弃
+        int first = height - top - rows;
+        T strip_y_start = static_cast<T>(y_start + first * dy);
+        T strip_y_finish = static_cast<T>(y_start + (first + rows) * dy);
+
+        Strip strip;
+        strip.pixels.resize(rows * row_bytes);
+        strip.valid_rows = std::min(rows, height - top);
+        if (mandelbrotOpenCL) {
+            mandelbrotOpenCL->compute(strip.pixels.data(), static_cast<T>(x_start), static_cast<T>(x_finish), strip_y_start, strip_y_finish,
+                                      static_cast<T>(center_x), static_cast<T>(center_y));
+        } else {
+            mandelbrot_omp(strip.pixels.data(), width, rows, static_cast<T>(x_start), static_cast<T>(x_finish), strip_y_start, strip_y_finish,
+                           static_cast<T>(center_x), static_cast<T>(center_y));
+        }
+        pending.push(std::move(strip));
+    }
+
+    pending.close();
+    writer.join();
+    if (!out) {
+        std::cerr << "Failed to write output file: " << filename << std::endl;
+        exit(1);
+    }
+
+    if (stats) {
+        stats->strip_rows = rows;
+        stats->strips = strips;
+    }
+}
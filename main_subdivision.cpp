@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "main_openmp.cpp"
+
+// Mariani–Silver 矩形细分: 矩形边界上的迭代次数全部相同时处理内部, 否则二分递归.
+// 比像素还细的丝状结构可能从边界采样点之间穿进集合内部的矩形, 这时边界全为 max_iter 而内部有逃逸的像素,
+// 所以边界全为 max_iter 的矩形不填充, 内部逐点用 mandelbrot_escape_shortcut 计算 (结果与 mandelbrot_escape 一致,
+// 心形, 圆盘和周期轨道内的点几乎不花时间). 只有逃逸带 (边界迭代次数小于 max_iter) 的矩形直接填充.
+template<typename T>
+class MarianiSilver {
+public:
+    MarianiSilver(int* iters, int width, T x_start, T dx, T y_start, T dy, int max_iter)
+        : iters(iters), width(width), x_start(x_start), dx(dx), y_start(y_start), dy(dy), max_iter(max_iter), filled(0) {}
+
+    // 处理闭区间矩形 [x0, x1] x [y0, y1]
+    void subdivide(int x0, int y0, int x1, int y1) {
+        int first = sample(x0, y0);
+        bool uniform = true;
+        for (int x = x0; x <= x1; ++x) {
+            uniform &= (sample(x, y0) == first);
+            uniform &= (sample(x, y1) == first);
+        }
+        for (int y = y0 + 1; y < y1; ++y) {
+            uniform &= (sample(x0, y) == first);
+            uniform &= (sample(x1, y) == first);
+        }
+
+        if (uniform && first == max_iter) {
+            for (int y = y0 + 1; y < y1; ++y) {
+                for (int x = x0 + 1; x < x1; ++x) {
+                    int& iter = iters[y * width + x];
+                    if (iter < 0) {
+                        int shortcut;
+                        iter = mandelbrot_escape_shortcut(x_start + x * dx, y_start + y * dy, max_iter, shortcut);
+                    }
+                }
+            }
+            return;
+        }
+        if (uniform) {
+            for (int y = y0 + 1; y < y1; ++y) {
+                for (int x = x0 + 1; x < x1; ++x) {
+                    if (iters[y * width + x] < 0) {
+                        iters[y * width + x] = first;
+                        ++filled;
+                    }
+                }
+            }
+            return;
+        }
+
+        if (x1 - x0 < min_size || y1 - y0 < min_size) {
+            for (int y = y0 + 1; y < y1; ++y) {
+                for (int x = x0 + 1; x < x1; ++x) {
+                    sample(x, y);
+                }
+            }
+            return;
+        }
+
+        // 沿较长的一边切开, 切线由两个子矩形共用, 已计算的像素会被缓存
+        if (x1 - x0 >= y1 - y0) {
+            int mid = (x0 + x1) / 2;
+            subdivide(x0, y0, mid, y1);
+            subdivide(mid, y0, x1, y1);
+        } else {
+            int mid = (y0 + y1) / 2;
+            subdivide(x0, y0, x1, mid);
+            subdivide(x0, mid, x1, y1);
+        }
+    }
+
+    long long filledPixels() const { return filled; }
+
+private:
+    static const int min_size = 6;
+
+    int* iters;
+    int width;
+    T x_start, dx, y_start, dy;
+    int max_iter;
+    long long filled;
+
+    int sample(int x, int y) {
+        int& iter = iters[y * width + x];
+        if (iter < 0) {
+            T real = x_start + x * dx;
+            T imag = y_start + y * dy;
+            iter = mandelbrot_escape(real, imag, max_iter);
+        }
+        return iter;
+    }
+};
+
+struct SubdivisionStats {
+    long long filled = 0;   // 未经迭代直接填充的像素数
+};
+
+// 帧被切成 tile_size x tile_size 的块, 各块独立细分并在线程间动态分配
+template<typename T>
+void mandelbrot_subdivision(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y,
+                            int tile_size = 64, SubdivisionStats* stats = nullptr, int max_iter = 256) {
+    T dx = (x_finish - x_start) / width;
+    T dy = (y_finish - y_start) / height;
+
+    std::vector<int> iters(width * height, -1);
+    int tiles_x = (width + tile_size - 1) / tile_size;
+    int tiles_y = (height + tile_size - 1) / tile_size;
+    long long filled = 0;
+
+    #pragma omp parallel for schedule(dynamic) reduction(+:filled)
+    for (int tile = 0; tile < tiles_x * tiles_y; ++tile) {
+        int x0 = (tile % tiles_x) * tile_size;
+        int y0 = (tile / tiles_x) * tile_size;
+        int x1 = std::min(x0 + tile_size, width) - 1;
+        int y1 = std::min(y0 + tile_size, height) - 1;
+
+        MarianiSilver<T> renderer(iters.data(), width, x_start, dx, y_start, dy, max_iter);
+        renderer.subdivide(x0, y0, x1, y1);
+        filled += renderer.filledPixels();
+    }
+
+    #pragma omp parallel for
+    for (int i = 0; i < width * height; ++i) {
+        mandelbrot_color(iters[i], max_iter, output + i * 3);
+    }
+
+    if (stats) {
+        stats->filled = filled;
+    }
+}
@@ -0,0 +1,400 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "main_palette.cpp"
+
+// 平面按四叉树量化: 第 z 层的 tile 边长为 4 / 2^z, 覆盖 [-2, 2) 的网格向外无限延伸,
+// tile (tx, ty) 的像素 (px, py) 采样于 (-2 + (tx * size + px) * pixel, -2 + (ty * size + py) * pixel).
+struct TileKey {
+    int z;
+    int max_iter;
+    int64_t tx, ty;
+
+    bool operator==(const TileKey& other) const {
+        return z == other.z && max_iter == other.max_iter && tx == other.tx && ty == other.ty;
+    }
+};
+
+struct TileKeyHash {
+    size_t operator()(const TileKey& key) const {
+        uint64_t h = static_cast<uint64_t>(key.tx) * 0x9E3779B97F4A7C15ull;
+        h ^= static_cast<uint64_t>(key.ty) + 0x632BE59BD9B4E019ull + (h << 6) + (h >> 2);
+        h ^= (static_cast<uint64_t>(key.z) << 32 | static_cast<uint32_t>(key.max_iter)) + (h << 6) + (h >> 2);
+        return static_cast<size_t>(h);
+    }
+};
+
+// 可增长的内存映射文件
+class MappedFile {
+public:
+    MappedFile() : data_(nullptr), size_(0) {}
+    ~MappedFile() { close(); }
+
+    bool open(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        return map(static_cast<size_t>(size.QuadPart));
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        fstat(fd, &st);
+        return map(static_cast<size_t>(st.st_size));
+#endif
+    }
+
+    bool resize(size_t size) {
+        unmap();
+#ifdef _WIN32
+        LARGE_INTEGER offset;
+        offset.QuadPart = static_cast<LONGLONG>(size);
+        if (!SetFilePointerEx(file, offset, nullptr, FILE_BEGIN) || !SetEndOfFile(file)) {
+            return false;
+        }
+#else
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            return false;
+        }
+#endif
+        return map(size);
+    }
+
+    void close() {
+        unmap();
+#ifdef _WIN32
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+            file = INVALID_HANDLE_VALUE;
+        }
+#else
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+        }
+#endif
+    }
+
+    uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    uint8_t* data_;
+    size_t size_;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    bool map(size_t size) {
+        size_ = size;
+        if (size == 0) {
+            return true;
+        }
+#ifdef _WIN32
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+        if (!mapping) {
+            return false;
+        }
+        data_ = static_cast<uint8_t*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size));
+#else
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        data_ = (p == MAP_FAILED) ? nullptr : static_cast<uint8_t*>(p);
+#endif
+        return data_ != nullptr;
+    }
+
+    void unmap() {
+#ifdef _WIN32
+        if (data_) {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+#else
+        if (data_) {
+            munmap(data_, size_);
+        }
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
+
+// 磁盘上的 tile 存储: 单个文件由定长槽位组成, 每个槽位是头部加迭代场; 启动时扫描头部重建索引
+class DiskTileStore {
+public:
+    explicit DiskTileStore(int tile_size) : tile_size(tile_size), used(0) {}
+
+    bool open(const std::string& path) {
+        if (!file.open(path)) {
+            std::cerr << "Failed to open tile store: " << path << std::endl;
+            return false;
+        }
+        size_t slots = file.size() / slotBytes();
+        for (size_t slot = 0; slot < slots; ++slot) {
+            const SlotHeader* header = reinterpret_cast<const SlotHeader*>(file.data() + slot * slotBytes());
+            if (header->magic != magic) {
+                break;
+            }
+            if (header->tile_size == tile_size) {
+                index[header->key] = slot;
+            }
+            used = slot + 1;
+        }
+        return true;
+    }
+
+    bool load(const TileKey& key, uint16_t* iters) const {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return false;
+        }
+        std::memcpy(iters, file.data() + it->second * slotBytes() + sizeof(SlotHeader), tileBytes());
+        return true;
+    }
+
+    bool contains(const TileKey& key) const { return index.count(key) != 0; }
+
+    void store(const TileKey& key, const uint16_t* iters) {
+        if (contains(key)) {
+            return;
+        }
+        if ((used + 1) * slotBytes() > file.size()) {
+            // 按块扩展文件, 避免每个 tile 都重新映射
+            size_t slots = std::max<size_t>(used * 2, 64);
+            if (!file.resize(slots * slotBytes())) {
+                std::cerr << "Failed to grow tile store" << std::endl;
+                return;
+            }
+        }
+        uint8_t* slot = file.data() + used * slotBytes();
+        std::memcpy(slot + sizeof(SlotHeader), iters, tileBytes());
+        SlotHeader header;
+        header.magic = magic;
+        header.tile_size = tile_size;
+        header.key = key;
+        std::memcpy(slot, &header, sizeof(header));
+        index[key] = used++;
+    }
+
+    size_t tiles() const { return index.size(); }
+
+private:
+    static const uint32_t magic = 0x4D424C54;   // "MBLT"
+
+    struct SlotHeader {
+        uint32_t magic;
+        int32_t tile_size;
+        TileKey key;
+    };
+
+    int tile_size;
+    size_t used;
+    MappedFile file;
+    std::unordered_map<TileKey, size_t, TileKeyHash> index;
+
+    size_t tileBytes() const { return static_cast<size_t>(tile_size) * tile_size * sizeof(uint16_t); }
+    size_t slotBytes() const { return sizeof(SlotHeader) + tileBytes(); }
+};
+
+struct TileCacheStats {
+    long long hits = 0;        // 内存命中
+    long long disk_hits = 0;   // 从磁盘读回
+    long long misses = 0;      // 需要计算
+};
+
+// 视口请求由缓存的 tile 拼出, 只计算缺失的 tile. 内存中按 LRU 保存, 超出预算时把最久未用的 tile
+// 写入磁盘存储后丢弃. 接口不是线程安全的, 每个缓存只应由一个线程使用.
+class TileCache {
+public:
+    // compute(iters, size, x_start, x_finish, y_start, y_finish, max_iter) 计算一个 tile 的迭代场
+    typedef std::function<void(uint16_t*, int, double, double, double, double, int)> ComputeTile;
+
+    TileCache(size_t memory_budget = 256u << 20, const std::string& store_path = "", int tile_size = 256)
+        : tile_size(tile_size), budget(memory_budget), bytes(0), disk(tile_size), has_disk(false) {
+        compute = [](uint16_t* iters, int size, double x0, double x1, double y0, double y1, int max_iter) {
+            mandelbrot_field(iters, size, size, x0, x1, y0, y1, 0.5 * (x0 + x1), 0.5 * (y0 + y1), max_iter);
+        };
+        if (!store_path.empty()) {
+            has_disk = disk.open(store_path);
+        }
+    }
+
+    ~TileCache() { flush(); }
+
+    void setCompute(ComputeTile function) { compute = function; }
+    const TileCacheStats& stats() const { return counters; }
+    void resetStats() { counters = TileCacheStats(); }
+    size_t memoryTiles() const { return lru.size(); }
+    size_t diskTiles() const { return disk.tiles(); }
+    int tileSize() const { return tile_size; }
+
+    // 让 tile 像素不大于输出像素的最浅层级
+    int levelFor(double pixel_size) const {
+        int z = static_cast<int>(std::ceil(std::log2(4.0 / (tile_size * pixel_size))));
+        return std::max(0, std::min(z, max_level));
+    }
+
+    // 返回的指针在下一次调用 tile() 之前有效
+    const uint16_t* tile(const TileKey& key) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            lru.splice(lru.begin(), lru, it->second);
+            ++counters.hits;
+            return lru.front().iters.data();
+        }
+
+        lru.emplace_front();
+        Tile& entry = lru.front();
+        entry.key = key;
+        entry.iters.resize(tile_size * tile_size);
+        if (has_disk && disk.load(key, entry.iters.data())) {
+            entry.on_disk = true;
+            ++counters.disk_hits;
+        } else {
+            double side = 4.0 / std::ldexp(1.0, key.z);
+            double x0 = -2.0 + key.tx * side;
+            double y0 = -2.0 + key.ty * side;
+            compute(entry.iters.data(), tile_size, x0, x0 + side, y0, y0 + side, key.max_iter);
+            entry.on_disk = false;
+            ++counters.misses;
+        }
+        index[key] = lru.begin();
+        bytes += tileBytes();
+        evict();
+        return entry.iters.data();
+    }
+
+    // 按输出像素最近的 tile 像素重采样, 写出迭代场
+    void field(uint16_t* iters, int width, int height, double x_start, double x_finish, double y_start, double y_finish, int max_iter = 256) {
+        double dx = (x_finish - x_start) / width;
+        double dy = (y_finish - y_start) / height;
+        int z = levelFor(std::min(dx, dy));
+        double pixel = 4.0 / (std::ldexp(1.0, z) * tile_size);
+
+        // 每列/每行对应的全局 tile 像素编号, 单调不减
+        std::vector<int64_t> gx(width), gy(height);
+        for (int x = 0; x < width; ++x) {
+            gx[x] = static_cast<int64_t>(std::floor((x_start + x * dx + 2.0) / pixel + 0.5));
+        }
+        for (int y = 0; y < height; ++y) {
+            gy[y] = static_cast<int64_t>(std::floor((y_start + y * dy + 2.0) / pixel + 0.5));
+        }
+
+        for (int y0 = 0; y0 < height;) {
+            int64_t ty = floorDiv(gy[y0], tile_size);
+            int y1 = y0;
+            while (y1 < height && floorDiv(gy[y1], tile_size) == ty) {
+                ++y1;
+            }
+            for (int x0 = 0; x0 < width;) {
+                int64_t tx = floorDiv(gx[x0], tile_size);
+                int x1 = x0;
+                while (x1 < width && floorDiv(gx[x1], tile_size) == tx) {
+                    ++x1;
+                }
+
+                const uint16_t* src = tile(TileKey{z, max_iter, tx, ty});
+                for (int y = y0; y < y1; ++y) {
+                    const uint16_t* row = src + (gy[y] - ty * tile_size) * tile_size;
+                    for (int x = x0; x < x1; ++x) {
+                        iters[y * width + x] = row[gx[x] - tx * tile_size];
+                    }
+                }
+                x0 = x1;
+            }
+            y0 = y1;
+        }
+    }
+
+    void render(uint8_t* output, int width, int height, double x_start, double x_finish, double y_start, double y_finish, int max_iter = 256) {
+        std::vector<uint16_t> iters(width * height);
+        field(iters.data(), width, height, x_start, x_finish, y_start, y_finish, max_iter);
+        if (palette.maxIter() != max_iter) {
+            palette = Palette(Palette::CLASSIC, max_iter);
+        }
+        colorize(iters.data(), width * height, palette, output);
+    }
+
+    // 把内存中尚未落盘的 tile 写入磁盘存储
+    void flush() {
+        if (!has_disk) {
+            return;
+        }
+        for (Tile& entry : lru) {
+            if (!entry.on_disk) {
+                disk.store(entry.key, entry.iters.data());
+                entry.on_disk = true;
+            }
+        }
+    }
+
+private:
+    // 更深时 tile 像素只相当于几十个 ulp, 坐标量化误差不可忽略
+    static const int max_level = 40;
+
+    struct Tile {
+        TileKey key;
+        std::vector<uint16_t> iters;
+        bool on_disk = false;
+    };
+
+    int tile_size;
+    size_t budget;
+    size_t bytes;
+    std::list<Tile> lru;
+    std::unordered_map<TileKey, std::list<Tile>::iterator, TileKeyHash> index;
+    DiskTileStore disk;
+    bool has_disk;
+    ComputeTile compute;
+    TileCacheStats counters;
+    Palette palette;
+
+    size_t tileBytes() const { return static_cast<size_t>(tile_size) * tile_size * sizeof(uint16_t); }
+
+    static int64_t floorDiv(int64_t a, int64_t b) {
+        int64_t q = a / b;
+        return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+    }
+
+    // 至少保留刚访问的 tile
+    void evict() {
+        while (bytes > budget && lru.size() > 1) {
+            Tile& victim = lru.back();
+            if (has_disk && !victim.on_disk) {
+                disk.store(victim.key, victim.iters.data());
+            }
+            index.erase(victim.key);
+            lru.pop_back();
+            bytes -= tileBytes();
+        }
+    }
+};
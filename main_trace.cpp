@@ -0,0 +1,192 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+
+// 热路径插桩: 每个线程把事件追加到自己的缓冲区, 只有第一次记录时加锁登记缓冲区.
+// 关闭时每个插桩点只多一次对 Tracer::enabled() 的判断. 结果导出为 Chrome trace JSON
+// (chrome://tracing 或 Perfetto 打开), 另有按事件名汇总的文本摘要.
+struct TraceEvent {
+    const char* name;       // 必须是字符串常量, 记录时不复制
+    const char* category;
+    double start;           // 微秒, 相对于 Tracer 创建的时刻
+    double duration;
+    const char* counter;    // 附加计数的名字, 为空表示没有
+    long long value;
+};
+
+class Tracer {
+public:
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    // 需要在创建 MandelbrotOpenCL 之前打开, 命令队列只在初始化时决定是否启用 profiling
+    static void enable(bool on = true) { active = on; }
+    static bool enabled() { return active; }
+
+    double now() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // 记录到调用线程的轨道
+    void record(const char* name, const char* category, double start, double duration, const char* counter = nullptr, long long value = 0) {
+        local().events.push_back({name, category, start, duration, counter, value});
+    }
+
+    struct Track {
+        std::string name;
+        std::vector<TraceEvent> events;
+    };
+
+    // 记录到命名轨道, 用于设备队列这类不对应主机线程的时间线; 调用方需保证同一轨道不被并发写入
+    void record(Track* lane, const char* name, const char* category, double start, double duration, const char* counter = nullptr, long long value = 0) {
+        lane->events.push_back({name, category, start, duration, counter, value});
+    }
+
+    // 每次调用都新建一条轨道, 同名的设备 (例如子设备) 也不会共用
+    Track* lane(const std::string& name) {
+        std::lock_guard<std::mutex> guard(lock);
+        tracks.emplace_back(new Track{name, {}});
+        return tracks.back().get();
+    }
+
+    // 给调用线程的轨道命名, 默认名为 "thread N"
+    void nameThread(const std::string& name) {
+        Track& track = local();
+        std::lock_guard<std::mutex> guard(lock);
+        track.name = name;
+    }
+
+    // 以下两个函数应在所有记录线程结束后调用
+    void writeChromeTrace(const std::string& path) {
+        std::ofstream out(path);
+        if (!out.is_open()) {
+            std::cerr << "Failed to open trace file: " << path << std::endl;
+            exit(1);
+        }
+        out << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool first = true;
+        for (size_t tid = 0; tid < tracks.size(); ++tid) {
+            const Track& track = *tracks[tid];
+            out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << tid << ", \"args\": {\"name\": \""
+                << escape(track.name) << "\"}}";
+            first = false;
+            for (const TraceEvent& event : track.events) {
+                out << ",\n{\"name\": \"" << escape(event.name) << "\", \"cat\": \"" << escape(event.category) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+                    << ", \"ts\": " << event.start << ", \"dur\": " << event.duration;
+                if (event.counter) {
+                    out << ", \"args\": {\"" << escape(event.counter) << "\": " << event.value << "}";
+                }
+                out << "}";
+            }
+        }
+        out << "\n]}\n";
+    }
+
+    // 每个 (类别, 事件名) 一行: 次数, 总时间, 平均, 最大, 计数之和;
+    // 再按轨道列出各类别的忙碌时间, 线程间的差异即负载不均衡
+    void printSummary(std::ostream& out) const {
+        struct Total {
+            int count = 0;
+            double sum = 0.0, max = 0.0;
+            long long value = 0;
+        };
+        std::map<std::string, Total> totals;
+        for (const auto& track : tracks) {
+            for (const TraceEvent& event : track->events) {
+                Total& total = totals[std::string(event.category) + "/" + event.name];
+                ++total.count;
+                total.sum += event.duration;
+                total.max = std::max(total.max, event.duration);
+                total.value += event.counter ? event.value : 0;
+            }
+        }
+
+        out << std::left << std::setw(28) << "event" << std::right << std::setw(8) << "count" << std::setw(12) << "total ms" << std::setw(12) << "mean ms"
+            << std::setw(12) << "max ms" << std::setw(16) << "counter" << std::endl;
+        out << std::fixed << std::setprecision(3);
+        for (const auto& entry : totals) {
+            const Total& total = entry.second;
+            out << std::left << std::setw(28) << entry.first << std::right << std::setw(8) << total.count << std::setw(12) << total.sum / 1000.0
+                << std::setw(12) << total.sum / 1000.0 / total.count << std::setw(12) << total.max / 1000.0 << std::setw(16) << total.value << std::endl;
+        }
+
+        out << std::left << std::setw(28) << "track" << std::right << std::setw(12) << "category" << std::setw(12) << "busy ms" << std::endl;
+        for (const auto& track : tracks) {
+            std::map<std::string, double> busy;
+            for (const TraceEvent& event : track->events) {
+                busy[event.category] += event.duration;
+            }
+            for (const auto& entry : busy) {
+                out << std::left << std::setw(28) << track->name << std::right << std::setw(12) << entry.first << std::setw(12) << entry.second / 1000.0
+                    << std::endl;
+            }
+        }
+        out << std::defaultfloat << std::setprecision(6);
+    }
+
+private:
+    inline static bool active = false;
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::mutex lock;
+    std::vector<std::unique_ptr<Track>> tracks;   // 轨道地址不变, 线程可以一直持有自己的指针
+
+    Track& local() {
+        thread_local Track* track = nullptr;
+        if (!track) {
+            std::lock_guard<std::mutex> guard(lock);
+            tracks.emplace_back(new Track{"thread " + std::to_string(tracks.size()), {}});
+            track = tracks.back().get();
+        }
+        return *track;
+    }
+
+    static std::string escape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+};
+
+// 作用域计时: 构造时记下开始时间, 析构时记录到调用线程的轨道; 插桩关闭时什么也不做
+class TraceScope {
+public:
+    TraceScope(const char* name, const char* category) : name(name), category(category), counter(nullptr), value(0), start(-1.0) {
+        if (Tracer::enabled()) {
+            start = Tracer::instance().now();
+        }
+    }
+
+    ~TraceScope() {
+        if (start >= 0.0) {
+            Tracer& tracer = Tracer::instance();
+            tracer.record(name, category, start, tracer.now() - start, counter, value);
+        }
+    }
+
+    void count(const char* counter_name, long long counter_value) {
+        counter = counter_name;
+        value = counter_value;
+    }
+
+private:
+    const char* name;
+    const char* category;
+    const char* counter;
+    long long value;
+    double start;
+};
@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "main_strip.cpp"
+
+// 海报级大图渲染: poster <width> <height> <output.ppm> [--engine omp|opencl] [--budget MB]
+//                [--center x y] [--scale s] [--precision float|double]
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <width> <height> <output.ppm> [--engine omp|opencl] [--budget MB]"
+              << " [--center x y] [--scale s] [--precision float|double]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    int width = std::stoi(argv[1]);
+    int height = std::stoi(argv[2]);
+    std::string filename = argv[3];
+    double center_x = -0.5, center_y = 0.0;
+    double scale = 3.0;
+    bool use_double = true;
+    StripOptions options;
+
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine" && i + 1 < argc) {
+            options.engine = argv[++i];
+            if (options.engine != "omp" && options.engine != "opencl") {
+                std::cerr << "Unknown engine: " << options.engine << std::endl;
+                return 1;
+            }
+        } else if (arg == "--budget" && i + 1 < argc) {
+            options.budget = static_cast<size_t>(std::stod(argv[++i]) * (1 << 20));
+        } else if (arg == "--center" && i + 2 < argc) {
+            center_x = std::stod(argv[++i]);
+            center_y = std::stod(argv[++i]);
+        } else if (arg == "--scale" && i + 1 < argc) {
+            scale = std::stod(argv[++i]);
+        } else if (arg == "--precision" && i + 1 < argc) {
+            use_double = std::string(argv[++i]) != "float";
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (width <= 0 || height <= 0) {
+        std::cerr << "Invalid image size: " << width << "x" << height << std::endl;
+        return 1;
+    }
+
+    StripStats stats;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (use_double) {
+        render_strips<double>(filename, width, height, center_x, center_y, scale, options, &stats);
+    } else {
+        render_strips<float>(filename, width, height, center_x, center_y, scale, options, &stats);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << "Rendered " << width << "x" << height << " to " << filename << " in " << stats.strips << " strips of "
+              << stats.strip_rows << " rows (" << std::chrono::duration<double>(end - start).count() << " seconds)" << std::endl;
+    return 0;
+}
@@ -6,14 +6,31 @@
 #include <fstream>
 #include <filesystem>
 #include <chrono>
-#include <cstdlib> 
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <map>
+#include <memory>
+#include <thread>
+#include <algorithm>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 #include "main_opencl.cpp"
+#include "main_multidevice.cpp"
+#include "main_openmp.cpp"
+#include "main_incremental.cpp"
+#include "main_pipeline.cpp"
+#include "main_trace.cpp"
 #include "lodepng.h"
 
 #define WIDTH 800
 #define HEIGHT 600
 
-void renderImage(uint8_t* output, GLuint texture) {
+// top_down 的帧第一行是图像顶部, 纹理坐标上下颠倒即可, 不必翻转数据
+void renderImage(const uint8_t* output, GLuint texture, bool top_down = false) {
     glBindTexture(GL_TEXTURE_2D, texture);
     glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, output);
 
@@ -22,11 +39,13 @@ void renderImage(uint8_t* output, GLuint texture) {
     glEnable(GL_TEXTURE_2D);
     glBindTexture(GL_TEXTURE_2D, texture);
 
+    float bottom = top_down ? 1.0f : 0.0f;
+    float top = 1.0f - bottom;
     glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 0.0f); glVertex2f(-1.0f, -1.0f);
-    glTexCoord2f(1.0f, 0.0f); glVertex2f(1.0f, -1.0f);
-    glTexCoord2f(1.0f, 1.0f); glVertex2f(1.0f, 1.0f);
-    glTexCoord2f(0.0f, 1.0f); glVertex2f(-1.0f, 1.0f);
+    glTexCoord2f(0.0f, bottom); glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(1.0f, bottom); glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(1.0f, top); glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, top); glVertex2f(-1.0f, 1.0f);
     glEnd();
 
     glDisable(GL_TEXTURE_2D);
@@ -69,33 +88,115 @@ void initOpenGL(GLFWwindow*& window, GLuint& texture) {
     glfwShowWindow(window);
 }
 
-template<typename T>
-void computeMandelbrot(uint8_t* output, int width, int height, T x_start, T x_finish, T y_start, T y_finish, T center_x, T center_y, MandelbrotOpenCL& mandelbrotOpenCL) {
-    mandelbrotOpenCL.compute(output, x_start, x_finish, y_start, y_finish, center_x, center_y);
+struct RenderOptions {
+    int num_frames = 360;       // 默认帧数
+    int frame_rate = 60;        // 默认帧率
+    bool headless = false;      // 不创建窗口, 适合没有显示器的节点
+    FrameFormat format = FORMAT_PNG;
+    std::string engine = "opencl";
+    double tolerance = 0.0;     // incremental 引擎的复用容差 (像素), 大于 0 时为近似复用
+    int encoders = 0;           // 编码线程数, 0 表示自动
+    int queue_size = 8;         // 每个队列最多容纳的帧数
+    DeviceSelection devices;    // opencl 引擎使用第一个匹配的设备, multi 引擎使用全部
+    std::string trace;          // 非空时记录各阶段耗时, 结束后写出 Chrome trace JSON
+    FractalSpec fractal;        // 非 Mandelbrot 集只支持 opencl 和 omp 引擎
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [frames] [frame_rate] [--headless] [--stream raw|y4m] [--engine opencl|omp|incremental|multi]"
+              << " [--tolerance pixels] [--encoders n] [--queue n] [--device gpu|cpu|accelerator|all] [--device-name text]"
+              << " [--device-index n] [--sub-devices n] [--trace trace.json] [--fractal mandelbrot|julia|multibrot|burning-ship] [--power n]"
+              << " [--julia re,im]" << std::endl;
 }
 
-void flipVertically(uint8_t* data, int width, int height) {
-    int row_size = width * 3;
-    std::vector<uint8_t> temp(row_size);
-    for (int i = 0; i < height / 2; ++i) {
-        uint8_t* row1 = data + i * row_size;
-        uint8_t* row2 = data + (height - i - 1) * row_size;
-        std::memcpy(temp.data(), row1, row_size);
-        std::memcpy(row1, row2, row_size);
-        std::memcpy(row2, temp.data(), row_size);
+RenderOptions parseOptions(int argc, char* argv[]) {
+    RenderOptions options;
+    int positional = 0;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--stream" && has_value) {
+            std::string format = argv[++i];
+            if (format == "raw") {
+                options.format = FORMAT_RAW;
+            } else if (format == "y4m") {
+                options.format = FORMAT_Y4M;
+            } else {
+                std::cerr << "Unknown stream format: " << format << std::endl;
+                exit(1);
+            }
+            // stdout 被帧数据占用, 不能再打开预览窗口
+            options.headless = true;
+        } else if (arg == "--engine" && has_value) {
+            options.engine = argv[++i];
+            if (options.engine != "opencl" && options.engine != "omp" && options.engine != "incremental" && options.engine != "multi") {
+                std::cerr << "Unknown engine: " << options.engine << std::endl;
+                exit(1);
+            }
+        } else if (arg == "--tolerance" && has_value) {
+            options.tolerance = std::stod(argv[++i]);
+        } else if (arg == "--encoders" && has_value) {
+            options.encoders = std::stoi(argv[++i]);
+        } else if (arg == "--queue" && has_value) {
+            options.queue_size = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--device" && has_value) {
+            options.devices.type = parse_device_type(argv[++i]);
+            options.devices.fallback = false;
+        } else if (arg == "--device-name" && has_value) {
+            options.devices.name = argv[++i];
+        } else if (arg == "--device-index" && has_value) {
+            options.devices.index = std::stoi(argv[++i]);
+        } else if (arg == "--sub-devices" && has_value) {
+            options.devices.sub_devices = std::stoi(argv[++i]);
+        } else if (arg == "--trace" && has_value) {
+            options.trace = argv[++i];
+        } else if (arg == "--fractal" && has_value) {
+            options.fractal.kind = parse_fractal_kind(argv[++i]);
+        } else if (arg == "--power" && has_value) {
+            options.fractal.power = std::stoi(argv[++i]);
+        } else if (arg == "--julia" && has_value) {
+            std::string value = argv[++i];
+            size_t comma = value.find(',');
+            if (comma == std::string::npos) {
+                std::cerr << "Expected --julia re,im, got " << value << std::endl;
+                exit(1);
+            }
+            options.fractal.julia_real = std::stod(value.substr(0, comma));
+            options.fractal.julia_imag = std::stod(value.substr(comma + 1));
+        } else if (arg[0] != '-' && positional == 0) {
+            options.num_frames = std::stoi(arg);
+            ++positional;
+        } else if (arg[0] != '-' && positional == 1) {
+            options.frame_rate = std::stoi(arg);
+            ++positional;
+        } else {
+            printUsage(argv[0]);
+            exit(1);
+        }
+    }
+    if (options.fractal.kind != FRACTAL_MANDELBROT && options.engine != "opencl" && options.engine != "omp") {
+        std::cerr << "The " << fractal_name(options.fractal.kind) << " fractal needs --engine opencl or omp" << std::endl;
+        exit(1);
+    }
+    if (options.encoders <= 0) {
+        options.encoders = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
     }
+    return options;
 }
 
-int main(int argc, char* argv[]) {
-    int num_frames = 360; // 默认帧数
-    int frame_rate = 60; // 默认帧率
+struct Frame {
+    int index = 0;
+    std::vector<uint8_t> data;   // 计算阶段为 RGB 像素, 编码阶段之后为待写出的字节
+    bool top_down = false;       // 引擎直接按图像行序写出, 编码时不需要翻转
+};
 
-    if (argc > 1) {
-        num_frames = std::stoi(argv[1]);
-    }
-    if (argc > 2) {
-        frame_rate = std::stoi(argv[2]);
-    }
+// 流水线: 计算 (主线程) -> 编码 (线程池, 含翻转与颜色空间转换) -> 写出 (单线程, 按帧序号排序)
+int main(int argc, char* argv[]) {
+    RenderOptions options = parseOptions(argc, argv);
+    // 必须在创建 OpenCL 引擎之前打开, 以便命令队列启用 profiling
+    Tracer::enable(!options.trace.empty());
 
     double x_start = -2.0, x_finish = 2.0;
     double y_start = -1.5, y_finish = 1.5;
@@ -105,39 +206,163 @@ int main(int argc, char* argv[]) {
     double scale = 1.0;
     double ratio = static_cast<double>(WIDTH) / HEIGHT;
 
-    GLFWwindow* window;
-    GLuint texture;
+    GLFWwindow* window = nullptr;
+    GLuint texture = 0;
+    if (!options.headless) {
+        initOpenGL(window, texture);
+    }
+
+#ifdef _WIN32
+    if (options.format != FORMAT_PNG) {
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+
+    std::unique_ptr<MandelbrotOpenCL> mandelbrotOpenCL;
+    std::unique_ptr<MultiDeviceOpenCL> multiDevice;
+    if (options.engine == "opencl") {
+        mandelbrotOpenCL.reset(new MandelbrotOpenCL(WIDTH, HEIGHT, select_devices(options.devices)[0]));
+    } else if (options.engine == "multi") {
+        multiDevice.reset(new MultiDeviceOpenCL(WIDTH, HEIGHT, options.devices));
+        for (int i = 0; i < multiDevice->deviceCount(); ++i) {
+            std::cerr << "Device " << i << ": " << multiDevice->deviceName(i) << std::endl;
+        }
+    }
+    IncrementalRenderer<double> incremental(WIDTH, HEIGHT, options.tolerance);
+    if (options.engine == "incremental" && incremental.approximate()) {
+        std::cerr << "Approximate reuse: samples within " << options.tolerance << " pixels are reused, frames may differ from a full render" << std::endl;
+    }
+
+    if (options.format == FORMAT_PNG) {
+        std::filesystem::create_directory("frames");
+    } else if (options.format == FORMAT_Y4M) {
+        std::string header = y4m_header(WIDTH, HEIGHT, options.frame_rate);
+        std::fwrite(header.data(), 1, header.size(), stdout);
+    }
 
-    initOpenGL(window, texture);
+    BoundedQueue<Frame> computed(options.queue_size);
+    BoundedQueue<Frame> encoded(options.queue_size);
 
-    std::vector<uint8_t> output(WIDTH * HEIGHT * 3);
-    MandelbrotOpenCL mandelbrotOpenCL(WIDTH, HEIGHT);
+    std::vector<std::thread> encoders;
+    for (int t = 0; t < options.encoders; ++t) {
+        encoders.emplace_back([&, t]() {
+            if (Tracer::enabled()) {
+                Tracer::instance().nameThread("encoder " + std::to_string(t));
+            }
+            Frame frame;
+            while (computed.pop(frame)) {
+                {
+                    TraceScope scope("encode", "pipeline");
+                    scope.count("frame", frame.index);
+                    frame.data = encode_frame(frame.data, WIDTH, HEIGHT, options.format, !frame.top_down);
+                }
+                encoded.push(std::move(frame));
+            }
+        });
+    }
 
-    std::filesystem::create_directory("frames");
+    // 编码线程完成顺序不定, 先到的帧暂存, 直到前面的帧全部写出
+    std::thread writer([&]() {
+        if (Tracer::enabled()) {
+            Tracer::instance().nameThread("writer");
+        }
+        std::map<int, std::vector<uint8_t>> waiting;
+        int next = 0;
+        Frame frame;
+        while (encoded.pop(frame)) {
+            waiting[frame.index] = std::move(frame.data);
+            for (auto it = waiting.find(next); it != waiting.end(); it = waiting.find(next)) {
+                TraceScope scope("write", "pipeline");
+                scope.count("frame", next);
+                if (options.format == FORMAT_PNG) {
+                    std::string filename = "frames/frame_" + std::to_string(next) + ".png";
+                    lodepng::save_file(it->second, filename);
+                } else {
+                    std::fwrite(it->second.data(), 1, it->second.size(), stdout);
+                }
+                waiting.erase(it);
+                ++next;
+            }
+        }
+        std::fflush(stdout);
+    });
 
-    for (int i = 0; i < num_frames; ++i) {
+    if (Tracer::enabled()) {
+        Tracer::instance().nameThread("compute");
+    }
+    bool fractal = options.fractal.kind != FRACTAL_MANDELBROT;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < options.num_frames; ++i) {
         updateParameters(scale, x_start, x_finish, y_start, y_finish, center_x, center_y, ratio, zoom_factor);
-        computeMandelbrot(output.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, mandelbrotOpenCL);
 
-        renderImage(output.data(), texture);
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        Frame frame;
+        frame.index = i;
+        frame.data.resize(WIDTH * HEIGHT * 3);
+        {
+            TraceScope scope("compute", "pipeline");
+            scope.count("frame", i);
+            // opencl 和 omp 引擎通过输出视图直接写成图像行序, 省去编码阶段的翻转
+            OutputView view(frame.data.data(), WIDTH, HEIGHT, PIXEL_RGB8, TOP_DOWN);
+            if (fractal && options.engine == "opencl") {
+                mandelbrotOpenCL->computeFractal(frame.data.data(), x_start, x_finish, y_start, y_finish, center_x, center_y, options.fractal);
+            } else if (fractal) {
+                fractal_omp(frame.data.data(), WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y, options.fractal);
+            } else if (options.engine == "opencl") {
+                mandelbrotOpenCL->compute(view, x_start, x_finish, y_start, y_finish, center_x, center_y);
+                frame.top_down = true;
+            } else if (options.engine == "multi") {
+                multiDevice->compute(frame.data.data(), x_start, x_finish, y_start, y_finish, center_x, center_y);
+            } else if (options.engine == "omp") {
+                mandelbrot_omp(view, WIDTH, HEIGHT, x_start, x_finish, y_start, y_finish, center_x, center_y);
+                frame.top_down = true;
+            } else {
+                incremental.render(frame.data.data(), x_start, x_finish, y_start, y_finish);
+            }
+        }
+
+        if (window) {
+            renderImage(frame.data.data(), texture, frame.top_down);
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
 
-        // 保存当前帧为 PNG 文件
-        flipVertically(output.data(), WIDTH, HEIGHT); // 添加这行代码进行垂直翻转
-        std::string filename = "frames/frame_" + std::to_string(i) + ".png";
-        lodepng::encode(filename, output, WIDTH, HEIGHT, LCT_RGB);
+        // 编码跟不上时这里会阻塞, 单独记录以便与计算时间区分
+        TraceScope scope("queue wait", "pipeline");
+        computed.push(std::move(frame));
     }
 
-    glDeleteTextures(1, &texture);
-    glfwDestroyWindow(window);
-    glfwTerminate();
+    computed.close();
+    for (std::thread& encoder : encoders) {
+        encoder.join();
+    }
+    encoded.close();
+    writer.join();
 
-    // 使用 ffmpeg 合成 GIF 文件
-    std::string ffmpeg_command = "ffmpeg -framerate " + std::to_string(frame_rate) + " -i frames/frame_%d.png -vf \"scale=" + std::to_string(WIDTH) + ":-1:flags=lanczos\" -c:v gif -y output.gif";
-    std::system(ffmpeg_command.c_str());
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cerr << "Rendered " << options.num_frames << " frames in " << std::chrono::duration<double>(end - start).count()
+              << " seconds (" << options.encoders << " encoder threads)" << std::endl;
+    if (multiDevice) {
+        for (int i = 0; i < multiDevice->deviceCount(); ++i) {
+            std::cerr << "Device " << i << " final band: " << multiDevice->bands()[i] << " rows" << std::endl;
+        }
+    }
+    if (Tracer::enabled()) {
+        Tracer::instance().writeChromeTrace(options.trace);
+        Tracer::instance().printSummary(std::cerr);
+        std::cerr << "Trace written to " << options.trace << std::endl;
+    }
+
+    if (window) {
+        glDeleteTextures(1, &texture);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+    }
 
-    
+    if (options.format == FORMAT_PNG) {
+        // 使用 ffmpeg 合成 GIF 文件
+        std::string ffmpeg_command = "ffmpeg -framerate " + std::to_string(options.frame_rate) + " -i frames/frame_%d.png -vf \"scale=" + std::to_string(WIDTH) + ":-1:flags=lanczos\" -c:v gif -y output.gif";
+        std::system(ffmpeg_command.c_str());
+    }
 
     return 0;
 }
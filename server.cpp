@@ -0,0 +1,334 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <omp.h>
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int socket_t;
+#define close_socket close
+#define INVALID_SOCKET (-1)
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#include "main_openmp.cpp"
+#include "main_maxiter.cpp"
+#include "main_pipeline.cpp"
+#include "lodepng.h"
+
+// XYZ 瓦片服务: GET /z/x/y.png. 第 z 层把 [-2, 2] x [-2, 2] 切成 2^z x 2^z 个 256x256 的瓦片,
+// y = 0 在最上方. 只依赖 OpenMP 引擎, 可以在没有 GPU 的机器上压测.
+static const int TILE_SIZE = 256;
+
+struct TileRequest {
+    int z;
+    long long x, y;
+
+    bool operator<(const TileRequest& other) const {
+        if (z != other.z) return z < other.z;
+        if (x != other.x) return x < other.x;
+        return y < other.y;
+    }
+};
+
+struct ServerStats {
+    std::atomic<long long> requests{0};
+    std::atomic<long long> coalesced{0};    // 与正在计算的同一瓦片合并的请求
+    std::atomic<long long> batches{0};
+    std::atomic<long long> tiles{0};        // 实际渲染的瓦片数
+};
+
+// 一次引擎调度渲染一批瓦片: 所有瓦片的所有行放进同一个 OpenMP 循环, 线程间动态分配
+void render_tile_batch(const std::vector<TileRequest>& batch, std::vector<std::vector<uint8_t>>& pixels) {
+    int count = static_cast<int>(batch.size());
+    pixels.assign(count, std::vector<uint8_t>(TILE_SIZE * TILE_SIZE * 3));
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int job = 0; job < count * TILE_SIZE; ++job) {
+        const TileRequest& tile = batch[job / TILE_SIZE];
+        int py = job % TILE_SIZE;
+        double side = 4.0 / static_cast<double>(1LL << tile.z);
+        double pixel = side / TILE_SIZE;
+        int max_iter = adaptive_max_iter(side);
+        double x_start = -2.0 + tile.x * side;
+        // 图像第 0 行是瓦片的上边缘
+        double imag = 2.0 - tile.y * side - py * pixel;
+
+        uint8_t* row = pixels[job / TILE_SIZE].data() + py * TILE_SIZE * 3;
+        for (int px = 0; px < TILE_SIZE; ++px) {
+            double real = x_start + px * pixel;
+            mandelbrot_color(mandelbrot_escape(real, imag, max_iter), max_iter, row + px * 3);
+        }
+    }
+}
+
+// 合并与批处理: 同一瓦片的并发请求共享一个结果; 调度线程把等待中的瓦片攒成一批后一次渲染.
+// 正在处理的不同瓦片数超过 max_inflight 时, 新请求在 acquire 中阻塞, 形成反压.
+class TileBatcher {
+public:
+    TileBatcher(int max_batch, int max_inflight, ServerStats& stats)
+        : max_batch(max_batch), max_inflight(max_inflight), stats(stats), stopping(false), dispatcher([this] { run(); }) {}
+
+    ~TileBatcher() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+        }
+        work_ready.notify_all();
+        dispatcher.join();
+    }
+
+    // 返回瓦片的 PNG 数据, 阻塞到渲染完成
+    std::shared_ptr<const std::vector<uint8_t>> get(const TileRequest& tile) {
+        std::unique_lock<std::mutex> guard(lock);
+        auto it = inflight.find(tile);
+        std::shared_ptr<Pending> pending;
+        if (it != inflight.end()) {
+            pending = it->second;
+            ++stats.coalesced;
+        } else {
+            has_room.wait(guard, [this] { return static_cast<int>(inflight.size()) < max_inflight; });
+            // 等待期间别的请求可能已经提交了同一瓦片
+            it = inflight.find(tile);
+            if (it != inflight.end()) {
+                pending = it->second;
+                ++stats.coalesced;
+            } else {
+                pending = std::make_shared<Pending>();
+                inflight[tile] = pending;
+                queue.push_back(tile);
+                work_ready.notify_one();
+            }
+        }
+        done.wait(guard, [&pending] { return pending->ready; });
+        return pending->png;
+    }
+
+private:
+    struct Pending {
+        bool ready = false;
+        std::shared_ptr<const std::vector<uint8_t>> png;
+    };
+
+    int max_batch;
+    int max_inflight;
+    ServerStats& stats;
+    bool stopping;
+    std::mutex lock;
+    std::condition_variable work_ready, done, has_room;
+    std::map<TileRequest, std::shared_ptr<Pending>> inflight;
+    std::vector<TileRequest> queue;
+    std::thread dispatcher;
+
+    void run() {
+        while (true) {
+            std::vector<TileRequest> batch;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                work_ready.wait(guard, [this] { return stopping || !queue.empty(); });
+                if (stopping && queue.empty()) {
+                    return;
+                }
+                // 留一个很短的窗口让同时到达的请求进入同一批
+                work_ready.wait_for(guard, std::chrono::milliseconds(2), [this] { return static_cast<int>(queue.size()) >= max_batch; });
+                int take = std::min(static_cast<int>(queue.size()), max_batch);
+                batch.assign(queue.begin(), queue.begin() + take);
+                queue.erase(queue.begin(), queue.begin() + take);
+            }
+
+            std::vector<std::vector<uint8_t>> pixels;
+            render_tile_batch(batch, pixels);
+            std::vector<std::shared_ptr<const std::vector<uint8_t>>> pngs(batch.size());
+            #pragma omp parallel for schedule(dynamic)
+            for (int i = 0; i < static_cast<int>(batch.size()); ++i) {
+                auto png = std::make_shared<std::vector<uint8_t>>();
+                lodepng::encode(*png, pixels[i], TILE_SIZE, TILE_SIZE, LCT_RGB);
+                pngs[i] = png;
+            }
+            ++stats.batches;
+            stats.tiles += static_cast<long long>(batch.size());
+
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    auto it = inflight.find(batch[i]);
+                    it->second->png = pngs[i];
+                    it->second->ready = true;
+                    inflight.erase(it);
+                }
+            }
+            done.notify_all();
+            has_room.notify_all();
+        }
+    }
+};
+
+bool parse_tile_path(const std::string& path, TileRequest& tile) {
+    int z;
+    long long x, y;
+    char suffix[8] = {0};
+    if (std::sscanf(path.c_str(), "/%d/%lld/%lld.%7s", &z, &x, &y, suffix) != 4 || std::string(suffix) != "png") {
+        return false;
+    }
+    if (z < 0 || z > 40 || x < 0 || y < 0 || x >= (1LL << z) || y >= (1LL << z)) {
+        return false;
+    }
+    tile.z = z;
+    tile.x = x;
+    tile.y = y;
+    return true;
+}
+
+void send_all(socket_t client, const char* data, size_t size) {
+    while (size > 0) {
+        // 客户端提前断开时不能让 SIGPIPE 结束整个服务
+        int sent = send(client, data, static_cast<int>(size), MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return;
+        }
+        data += sent;
+        size -= sent;
+    }
+}
+
+void send_response(socket_t client, const std::string& status, const std::string& type, const char* body, size_t size) {
+    std::ostringstream header;
+    header << "HTTP/1.1 " << status << "\r\nContent-Type: " << type << "\r\nContent-Length: " << size
+           << "\r\nConnection: close\r\n\r\n";
+    std::string text = header.str();
+    send_all(client, text.data(), text.size());
+    send_all(client, body, size);
+}
+
+void handle_client(socket_t client, TileBatcher& batcher, ServerStats& stats) {
+    std::string request;
+    char buffer[4096];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16384) {
+        int received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        request.append(buffer, received);
+    }
+
+    std::istringstream line(request);
+    std::string method, path;
+    line >> method >> path;
+    ++stats.requests;
+
+    TileRequest tile;
+    if (method == "GET" && path == "/stats") {
+        std::ostringstream body;
+        body << "{\"requests\": " << stats.requests << ", \"coalesced\": " << stats.coalesced << ", \"batches\": " << stats.batches
+             << ", \"tiles\": " << stats.tiles << "}\n";
+        std::string text = body.str();
+        send_response(client, "200 OK", "application/json", text.data(), text.size());
+    } else if (method == "GET" && parse_tile_path(path, tile)) {
+        auto png = batcher.get(tile);
+        send_response(client, "200 OK", "image/png", reinterpret_cast<const char*>(png->data()), png->size());
+    } else {
+        static const char message[] = "Not found\n";
+        send_response(client, "404 Not Found", "text/plain", message, sizeof(message) - 1);
+    }
+    close_socket(client);
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--port n] [--workers n] [--batch n] [--inflight n]" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    int port = 8080;
+    int workers = 32;       // 同时处理的连接数
+    int max_batch = 64;     // 每次引擎调度最多的瓦片数
+    int max_inflight = 256; // 正在排队或计算的不同瓦片数上限
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--port") {
+            port = std::stoi(argv[++i]);
+        } else if (arg == "--workers") {
+            workers = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--batch") {
+            max_batch = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--inflight") {
+            max_inflight = std::max(1, std::stoi(argv[++i]));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        std::cerr << "Failed to initialize Winsock" << std::endl;
+        return 1;
+    }
+#endif
+
+    socket_t listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == INVALID_SOCKET) {
+        std::cerr << "Failed to create socket" << std::endl;
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 128) != 0) {
+        std::cerr << "Failed to listen on 127.0.0.1:" << port << std::endl;
+        return 1;
+    }
+    std::cout << "Serving tiles on http://127.0.0.1:" << port << "/z/x/y.png (" << omp_get_max_threads() << " OpenMP threads)" << std::endl;
+
+    ServerStats stats;
+    TileBatcher batcher(max_batch, max_inflight, stats);
+
+    // 连接队列满时 accept 线程阻塞, 多出的连接留在内核的 listen 队列里
+    BoundedQueue<socket_t> connections(workers);
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i) {
+        pool.emplace_back([&]() {
+            socket_t client;
+            while (connections.pop(client)) {
+                handle_client(client, batcher, stats);
+            }
+        });
+    }
+
+    while (true) {
+        socket_t client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        connections.push(client);
+    }
+}